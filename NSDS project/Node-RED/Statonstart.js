@@ -1,13 +1,18 @@
-let groups = context.get('groups') || {};
-let dismantle_group = context.get('dismantle_groups') || {};
+// Groups live in the flow context, where the store node restores them after a restart
+let groups = flow.get('groups') || {};
 
-// Define the number of groups.
+// Define the number of groups: a fixed pool of slots (GROUP_POOL_SIZE), reused
+// as groups form and dismantle. A slot counts its groups in generation, so the
+// events of successive groups in the same slot can be told apart.
 const numMotes = 8
-const numGroups = Math.floor(numMotes / 3);
+const numGroups = parseInt(env.get('GROUP_POOL_SIZE') || String(Math.floor(numMotes / 3)), 10);
 
-// Create groups.
+// Create the groups that were not recovered.
 for (let k = 1; k <= numGroups; k++) {
     let groupName = "group " + k;
+    if (groups["group" + k]) {
+        continue;
+    }
 
     groups["group" + k] = {
         name: groupName,
@@ -16,12 +21,342 @@ for (let k = 1; k <= numGroups; k++) {
         maximum: 0,
         minimum: 0,
         average: 0,
+        variance: 0,
         index: 0,
         timestamp: 0,
         lifetime: 0,
-        dismantle_timer: 0
+        dismantle_timer: 0,
+        generation: 0,
+        // Time-weighted accumulators of the streaming statistics
+        last_change: 0,
+        weight: 0,
+        sum: 0,
+        sum_squares: 0
     };
 }
 
-context.set('groups', groups);
-context.set('dismantle_group', dismantle_group);
\ No newline at end of file
+// Time spent by the groups at each size (see the sketch in the message handler)
+if (!flow.get('sizeSketch')) {
+    flow.set('sizeSketch', new Float64Array(64 + 256 + 1));
+}
+
+// Table interning member addresses to handles. The Cooja input node looks
+// addresses up straight from the topic and the MQTT receive buffer, so the
+// address string is only allocated the first time it is seen.
+//
+// The table is a pool of MEMBER_POOL_SIZE slots allocated up front, so a
+// long-running backend holds the same memory however many motes come and go.
+// A handle is the slot in the low SLOT_BITS bits and the generation of the
+// slot above them: releasing a slot bumps its generation, so handles kept
+// anywhere after their mote was evicted no longer match (isLive) instead of
+// silently naming the mote that reused the slot.
+const FNV_OFFSET = 0x811c9dc5 | 0;
+const FNV_PRIME = 16777619;
+const SLOT_BITS = 20;
+const SLOT_MASK = (1 << SLOT_BITS) - 1;
+const GENERATION_MASK = (1 << (32 - SLOT_BITS)) - 1;
+const ADDRESS_MAX = 48;  // Bytes kept per address, IPv6 text takes at most 39
+
+function createInternTable(capacity) {
+    const names = new Array(capacity);             // Slot -> address, undefined when free
+    const hashes = new Int32Array(capacity);
+    const generations = new Uint16Array(capacity);
+    const lengths = new Uint8Array(capacity);
+    const arena = new Uint8Array(capacity * ADDRESS_MAX); // Bytes of every address, compared against the receive buffer
+    // Open addressing, slot + 1 (0 is empty), at most half full; a power of two
+    // so that probes wrap with a mask
+    const buckets = new Int32Array(1 << Math.ceil(Math.log2(2 * capacity)));
+    const free = new Int32Array(capacity);         // Stack of free slots
+    let freeCount = 0;
+    let highWater = 0;                             // Slots below this have been used at least once
+
+    const table = {
+        names: names,
+        FNV_OFFSET: FNV_OFFSET,
+        FNV_PRIME: FNV_PRIME,
+        capacity: capacity,
+        size: 0,
+        rejected: 0,    // Addresses not interned because the pool was full
+        // Set by the statistics node: frees the coldest slot it can, false if none
+        onFull: null
+    };
+
+    // FNV-1a (FNV_OFFSET, FNV_PRIME), addresses are ASCII so strings and bytes hash
+    // alike. The string and byte variants are kept apart so that each one stays monomorphic.
+    function hashString(src, start, end) {
+        let h = FNV_OFFSET;
+        for (let i = start; i < end; i++) {
+            h = Math.imul(h ^ src.charCodeAt(i), FNV_PRIME);
+        }
+        return h;
+    }
+
+    function hashBytes(src, start, end) {
+        let h = FNV_OFFSET;
+        for (let i = start; i < end; i++) {
+            h = Math.imul(h ^ src[i], FNV_PRIME);
+        }
+        return h;
+    }
+
+    function equalsBytes(slot, src, start, end) {
+        if (lengths[slot] !== end - start) {
+            return false;
+        }
+        for (let i = start, k = slot * ADDRESS_MAX; i < end; i++, k++) {
+            if (arena[k] !== src[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    function equalsString(slot, src, start, end) {
+        if (lengths[slot] !== end - start) {
+            return false;
+        }
+        for (let i = start, k = slot * ADDRESS_MAX; i < end; i++, k++) {
+            if (arena[k] !== src.charCodeAt(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    function handleOf(slot) {
+        return ((generations[slot] << SLOT_BITS) | slot) >>> 0;
+    }
+
+    // First sight of an address, -1 when the pool is full and nothing can be evicted
+    function add(name, h) {
+        if (name.length > ADDRESS_MAX) {
+            table.rejected++;
+            return -1;
+        }
+        if (freeCount === 0 && highWater === capacity && !(table.onFull && table.onFull())) {
+            table.rejected++;
+            return -1;
+        }
+        const slot = freeCount > 0 ? free[--freeCount] : highWater++;
+        names[slot] = name;
+        hashes[slot] = h;
+        lengths[slot] = name.length;
+        for (let i = 0; i < name.length; i++) {
+            arena[slot * ADDRESS_MAX + i] = name.charCodeAt(i);
+        }
+
+        const mask = buckets.length - 1;
+        let i = h & mask;
+        while (buckets[i] !== 0) {
+            i = (i + 1) & mask;
+        }
+        buckets[i] = slot + 1;
+        table.size++;
+        return handleOf(slot);
+    }
+
+    table.internString = function (src, start, end) {
+        const h = hashString(src, start, end);
+        const mask = buckets.length - 1;
+        for (let i = h & mask; buckets[i] !== 0; i = (i + 1) & mask) {
+            const slot = buckets[i] - 1;
+            if (hashes[slot] === h && equalsString(slot, src, start, end)) {
+                return handleOf(slot);
+            }
+        }
+        return add(src.slice(start, end), h);
+    };
+
+    // The caller may pass the FNV-1a hash it computed while scanning the bytes
+    table.internBytes = function (src, start, end, h = hashBytes(src, start, end)) {
+        const mask = buckets.length - 1;
+        for (let i = h & mask; buckets[i] !== 0; i = (i + 1) & mask) {
+            const slot = buckets[i] - 1;
+            if (hashes[slot] === h && equalsBytes(slot, src, start, end)) {
+                return handleOf(slot);
+            }
+        }
+        return add(src.toString('latin1', start, end), h);
+    };
+
+    table.intern = (name) => table.internString(name, 0, name.length);
+    table.slot = (handle) => handle & SLOT_MASK;
+    table.handle = handleOf;
+    table.isLive = (handle) => handle >= 0 && names[handle & SLOT_MASK] !== undefined &&
+                               generations[handle & SLOT_MASK] === handle >>> SLOT_BITS;
+    table.name = (handle) => names[handle & SLOT_MASK];
+    table.highWater = () => highWater;
+
+    // Function to free the slot of a handle, moving back the entries of its
+    // probe sequence so that lookups never stop at the hole
+    table.release = function (handle) {
+        const slot = handle & SLOT_MASK;
+        if (!table.isLive(handle)) {
+            return;
+        }
+        const mask = buckets.length - 1;
+        let hole = hashes[slot] & mask;
+        while (buckets[hole] !== slot + 1) {
+            hole = (hole + 1) & mask;
+        }
+        buckets[hole] = 0;
+        for (let i = (hole + 1) & mask; buckets[i] !== 0; i = (i + 1) & mask) {
+            const home = hashes[buckets[i] - 1] & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                buckets[hole] = buckets[i];
+                buckets[i] = 0;
+                hole = i;
+            }
+        }
+        names[slot] = undefined;
+        generations[slot] = (generations[slot] + 1) & GENERATION_MASK;
+        free[freeCount++] = slot;
+        table.size--;
+    };
+
+    return table;
+}
+
+// Interned member addresses; the sorted ID vectors of the groups are derived
+// from the member lists on demand, so they are never persisted
+if (!flow.get('memberIds')) {
+    flow.set('memberIds', createInternTable(parseInt(env.get('MEMBER_POOL_SIZE') || '65536', 10)));
+}
+context.set('memberVectors', new WeakMap());
+
+// Global contact graph: per mote the last reported contacts, the mutual edges,
+// the union-find forest of the components, the group slot of the mote and when
+// it was last heard. Indexed by the slot of the mote in the intern table, the
+// reports hold handles. It is rebuilt from the reports within a beacon period,
+// so it is not persisted.
+const memberPool = flow.get('memberIds').capacity;
+flow.set('contactGraph', {
+    reports: [],
+    adjacency: [],
+    parent: [],
+    component: [],
+    group: [],
+    lastReport: new Float64Array(memberPool),  // Last report of the mote itself
+    lastSeen: new Float64Array(memberPool),    // Last report by or about the mote
+    nextSweep: 0,
+    evicted: 0,
+    seeded: false,
+    seededAt: 0,     // Time of the seeding from the recovered groups
+    graceUntil: 0    // End of the grace period of the recovered groups, 0 once over
+});
+
+// Published group state. The statistics node owns the mutable groups; every
+// other reader gets an immutable snapshot, swapped in as a whole once a message
+// is processed (flow 'groupSnapshot' and msg.payload), so a reader holding one
+// sees a consistent state however far the writer moves on, and old snapshots
+// go away with their last reader. The groups are a persistent vector (32-way
+// trie by slot): a new snapshot copies the changed groups and the paths to
+// them and shares everything else with the previous one.
+const TRIE_BITS = 5;
+const TRIE_WIDTH = 1 << TRIE_BITS;
+const TRIE_MASK = TRIE_WIDTH - 1;
+
+function GroupSnapshot(epoch, time, keys, length, root, shift) {
+    this.epoch = epoch;      // Number of the publication, 0 before the first
+    this.time = time;
+    this.keys = keys;        // Slot -> group key, append-only and shared by all snapshots
+    this.length = length;    // Slots in this snapshot, later ones are not visible
+    this.root = root;
+    this.shift = shift;
+    Object.freeze(this);
+}
+
+GroupSnapshot.prototype.at = function (slot) {
+    let node = this.root;
+    for (let level = this.shift; level > 0 && node; level -= TRIE_BITS) {
+        node = node[(slot >>> level) & TRIE_MASK];
+    }
+    return node ? node[slot & TRIE_MASK] : undefined;
+};
+
+GroupSnapshot.prototype.get = function (key) {
+    const slot = snapshots.slots.get(key);
+    return slot === undefined || slot >= this.length ? undefined : this.at(slot);
+};
+
+GroupSnapshot.prototype.forEach = function (visit) {
+    for (let slot = 0; slot < this.length; slot++) {
+        const group = this.at(slot);
+        if (group !== undefined) {
+            visit(group, this.keys[slot]);
+        }
+    }
+};
+
+// Plain object of the groups, for the debug sidebar and JSON exports
+GroupSnapshot.prototype.toJSON = function () {
+    const groups = {};
+    this.forEach((group, key) => { groups[key] = group; });
+    return groups;
+};
+
+// Helper function to make an empty trie node. The nodes are never modified once
+// published; they are not frozen, V8 copies frozen arrays much more slowly.
+function trieNode() {
+    return new Array(TRIE_WIDTH).fill(undefined);
+}
+
+// Helper function to copy a path of the trie with one value replaced
+function trieSet(node, shift, slot, value) {
+    const copy = node ? node.slice() : trieNode();
+    if (shift === 0) {
+        copy[slot & TRIE_MASK] = value;
+    } else {
+        const i = (slot >>> shift) & TRIE_MASK;
+        copy[i] = trieSet(copy[i], shift - TRIE_BITS, slot, value);
+    }
+    return copy;
+}
+
+// Helper function to freeze a copy of a group, members included
+function freezeGroup(group) {
+    const copy = Object.assign({}, group);
+    copy.members = Object.freeze(group.members.slice());
+    return Object.freeze(copy);
+}
+
+const snapshots = {
+    slots: new Map(),   // Group key -> slot, never reassigned
+    keys: [],
+    current: new GroupSnapshot(0, 0, [], 0, trieNode(), 0)
+};
+
+// Function to publish the changed groups (a group missing from groups is
+// removed). Returns the new current snapshot, the previous one if nothing changed.
+snapshots.publish = function (groups, changed, now) {
+    const previous = snapshots.current;
+    if (changed.length === 0) {
+        return previous;
+    }
+    let root = previous.root;
+    let shift = previous.shift;
+    changed.forEach(key => {
+        let slot = snapshots.slots.get(key);
+        if (slot === undefined) {
+            slot = snapshots.keys.length;
+            snapshots.keys.push(key);
+            snapshots.slots.set(key, slot);
+        }
+        while (slot >= TRIE_WIDTH << shift) {
+            // One more level, the old trie becomes the first child
+            const grown = trieNode();
+            grown[0] = root;
+            root = grown;
+            shift += TRIE_BITS;
+        }
+        root = trieSet(root, shift, slot, groups[key] === undefined ? undefined : freezeGroup(groups[key]));
+    });
+    snapshots.current = new GroupSnapshot(previous.epoch + 1, now, snapshots.keys, snapshots.keys.length, root, shift);
+    flow.set('groupSnapshot', snapshots.current);
+    return snapshots.current;
+};
+
+// The groups recovered by the store are the first snapshot
+snapshots.publish(groups, Object.keys(groups), Date.now());
+flow.set('groupSnapshots', snapshots);
+flow.set('groups', groups);
\ No newline at end of file
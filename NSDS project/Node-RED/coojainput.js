@@ -1,22 +1,8 @@
-function extractMembersSender() {
-    let topicParts = msg.topic.split('/');
-    let sender = topicParts[2];
-
-    // Ensure 'members' property exists in msg.payload
-    if (!msg.payload || !msg.payload.hasOwnProperty('members')) {
-        msg.payload = {
-            sender: sender,
-            members: [sender]
-        };
-    } else {
-        // If 'members' property exists, add sender to the array
-        msg.payload.members.push(sender);
-    }
-
-    return msg.payload;
+// Clean the input, QoS 1 redeliveries and senders over the pool stop here
+const payload = context.get('extractMembersSender')(msg.topic, msg.payload);
+if (payload === null) {
+    return null;
 }
-
-// Clean the input
-msg.payload = extractMembersSender();
+msg.payload = payload;
 
 return msg;
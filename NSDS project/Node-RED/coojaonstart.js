@@ -0,0 +1,212 @@
+// The MQTT input delivers the raw receive buffer: topic and payload are scanned
+// in place and the addresses are interned without building intermediate strings.
+// The parser is built once here, the message handler only calls it.
+const TOPIC_PREFIX = 'nsds_gm/contacts/';
+const QUOTE = 0x22;
+// Created by the statistics node, whose initialization may run after this one
+let interned = null;
+// Reused while scanning a members array, only the final IDs are copied out
+let scratch = new Uint32Array(64);
+
+// QoS 1 duplicates: a mote whose PUBACK got lost publishes the same report
+// again. The motes number their reports ("seq", 16 bits), and the last
+// SEQ_WINDOW numbers seen from each sender are kept as a bitmask below the
+// highest one: a number already in it is a duplicate. A number further back
+// than the window comes from a rebooted mote, which starts at random.
+// Reports without a number (older firmware) fall back to the bytes: repeating
+// the sender's previous message within REDELIVERY_WINDOW is a redelivery.
+// Indexed by the slot of the sender, whose handle tells a reused slot apart.
+const SEQ_WINDOW = 32;
+const REDELIVERY_WINDOW = 10000;  // Milliseconds
+let lastSender = null;    // Slot -> handle of the sender the state below is about
+let highSeq = null;       // Slot -> highest sequence number seen, -1 if none
+let seenSeq = null;       // Slot -> bit k set when highSeq - k was seen
+let lastHash = null;      // Slot -> FNV-1a of the last message
+let lastTime = null;      // Slot -> arrival time of the last message
+
+// Dropped and accepted-anyway counts, served at /ingest by the ingest queue
+const dedup = { duplicates: 0, redeliveries: 0, restarts: 0 };
+flow.set('dedup', dedup);
+
+// Quoted JSON keys, searched natively in the receive buffer
+const KEY_EVENT = Buffer.from('"event"');
+const KEY_IP = Buffer.from('"ip"');
+const KEY_SEQ = Buffer.from('"seq"');
+const VALUE_DEPARTURE = Buffer.from('"departure"');
+
+// Helper function to find the position after a key in the buffer, -1 if missing
+function findKey(buffer, key) {
+    const i = buffer.indexOf(key);
+    return i < 0 ? -1 : i + key.length;
+}
+
+// Helper function to intern the string value following position i, -1 if missing
+function internStringAfter(buffer, i) {
+    const start = buffer.indexOf(QUOTE, i) + 1;
+    const end = start > 0 ? buffer.indexOf(QUOTE, start) : -1;
+    return end < 0 ? -1 : interned.internBytes(buffer, start, end);
+}
+
+// Helper function to find the opening bracket of the members array, -1 if missing.
+// The mote always writes the array last, so a plain scan beats a native key search.
+function findMembers(buffer) {
+    for (let k = 0; k < buffer.length; k++) {
+        if (buffer[k] === 0x5b) { // '['
+            return k;
+        }
+    }
+    return -1;
+}
+
+// Helper function to intern the members array opening at position open. Each
+// address is hashed while looking for its closing quote, so the bytes are
+// only read once more, by the intern table, to confirm the match.
+function internMembers(buffer, open) {
+    const offset = interned.FNV_OFFSET;
+    const prime = interned.FNV_PRIME;
+    let n = 0;
+
+    for (let k = open + 1; k < buffer.length && buffer[k] !== 0x5d; k++) { // ']'
+        if (buffer[k] !== QUOTE) {
+            continue;
+        }
+        const start = k + 1;
+        let h = offset;
+        for (k = start; k < buffer.length && buffer[k] !== QUOTE; k++) {
+            h = Math.imul(h ^ buffer[k], prime);
+        }
+        if (n === scratch.length) {
+            const grown = new Uint32Array(2 * scratch.length);
+            grown.set(scratch);
+            scratch = grown;
+        }
+        const id = interned.internBytes(buffer, start, k, h);
+        if (id >= 0) { // Left out when the pool is full
+            scratch[n++] = id;
+        }
+    }
+    return scratch.slice(0, n);
+}
+
+// Helper function to read the unsigned number following position i, -1 if missing
+function numberAfter(buffer, i) {
+    let k = i;
+    while (k < buffer.length && (buffer[k] < 0x30 || buffer[k] > 0x39)) { // Skip ': '
+        if (buffer[k] !== 0x3a && buffer[k] !== 0x20) {
+            return -1;
+        }
+        k++;
+    }
+    let value = -1;
+    for (; k < buffer.length && buffer[k] >= 0x30 && buffer[k] <= 0x39; k++) {
+        value = (value < 0 ? 0 : value * 10) + buffer[k] - 0x30;
+    }
+    return value;
+}
+
+// Helper function to start the state of a slot over for a new sender
+function claimSlot(slot, sender) {
+    if (lastSender[slot] !== sender) {
+        lastSender[slot] = sender;
+        highSeq[slot] = -1;
+        lastTime[slot] = -Infinity;
+    }
+}
+
+// Function to tell whether a sequence number was already seen from the sender
+function isDuplicate(slot, seq) {
+    const high = highSeq[slot];
+    if (high < 0) {
+        highSeq[slot] = seq;
+        seenSeq[slot] = 1;
+        return false;
+    }
+    const ahead = (seq - high) & 0xffff;
+    if (ahead === 0) {
+        return true;
+    }
+    if (ahead < 0x8000) {
+        // Newer: slide the window
+        seenSeq[slot] = ahead < SEQ_WINDOW ? (seenSeq[slot] << ahead) | 1 : 1;
+        highSeq[slot] = seq;
+        return false;
+    }
+    const behind = (high - seq) & 0xffff;
+    if (behind >= SEQ_WINDOW) {
+        dedup.restarts++;
+        highSeq[slot] = seq;
+        seenSeq[slot] = 1;
+        return false;
+    }
+    // Older but within the window and not seen yet: the uplinks deliver a
+    // mote's reports in order, so it is let through
+    if (seenSeq[slot] & (1 << behind)) {
+        return true;
+    }
+    seenSeq[slot] |= 1 << behind;
+    return false;
+}
+
+// Function to tell whether an unnumbered message repeats the sender's previous one
+function isRedelivery(slot, buffer, now) {
+    let h = interned.FNV_OFFSET;
+    for (let k = 0; k < buffer.length; k++) {
+        h = Math.imul(h ^ buffer[k], interned.FNV_PRIME);
+    }
+    const repeated = lastHash[slot] === h && now - lastTime[slot] < REDELIVERY_WINDOW;
+    lastHash[slot] = h;
+    lastTime[slot] = now;
+    return repeated;
+}
+
+// Returns null for a duplicate or a sender the pool could not take
+function extractMembersSender(topic, payload) {
+    if (interned === null) {
+        interned = flow.get('memberIds');
+        lastSender = new Uint32Array(interned.capacity);
+        highSeq = new Int32Array(interned.capacity).fill(-1);
+        seenSeq = new Uint32Array(interned.capacity);
+        lastHash = new Int32Array(interned.capacity);
+        lastTime = new Float64Array(interned.capacity).fill(-Infinity);
+    }
+    const buffer = Buffer.isBuffer(payload) ? payload : Buffer.from(JSON.stringify(payload));
+    const sender = interned.internString(topic, TOPIC_PREFIX.length, topic.length);
+
+    if (sender < 0) {
+        return null; // The pool is full, counted by the intern table
+    }
+    // The mote writes the number first
+    const slot = interned.slot(sender);
+    const seqKey = findKey(buffer, KEY_SEQ);
+    const seq = seqKey >= 0 ? numberAfter(buffer, seqKey) : -1;
+    claimSlot(slot, sender);
+    if (seq >= 0 ? isDuplicate(slot, seq & 0xffff) : isRedelivery(slot, buffer, Date.now())) {
+        if (seq >= 0) {
+            dedup.duplicates++;
+        } else {
+            dedup.redeliveries++;
+        }
+        return null;
+    }
+
+    let result;
+    const members = findMembers(buffer);
+    if (members >= 0) {
+        result = { sender: sender, contacts: internMembers(buffer, members) };
+    } else {
+        // Departures only name the contact that left
+        const event = findKey(buffer, KEY_EVENT);
+        const ip = findKey(buffer, KEY_IP);
+        if (event >= 0 && ip >= 0 && buffer.indexOf(VALUE_DEPARTURE, event) === buffer.indexOf(QUOTE, event)) {
+            result = { sender: sender, event: 'departure', ip: internStringAfter(buffer, ip) };
+        } else {
+            result = { sender: sender, contacts: new Uint32Array(0) };
+        }
+    }
+    if (seq >= 0) {
+        result.seq = seq & 0xffff;
+    }
+    return result;
+}
+
+context.set('extractMembersSender', extractMembersSender);
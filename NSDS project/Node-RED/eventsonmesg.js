@@ -0,0 +1,26 @@
+const stream = context.get('stream');
+const now = Date.now();
+
+// Resume requests, served at /events?epoch=<epoch>&since=<seq>
+if (msg.req) {
+    const query = msg.req.query || {};
+    msg.payload = stream.since(Number(query.epoch), query.since === undefined ? NaN : Number(query.since));
+    msg.statusCode = 200;
+    return [null, msg];
+}
+
+stream.groups = msg.payload;
+stream.fleet = msg.fleet || null;
+
+// Reports that change nothing in the groups add no events
+const published = stream.publish(msg.events || [], now);
+
+if (published.length === 0) {
+    return null;
+}
+return [published.map(event => ({
+    topic: 'nsds_gm/events/' + event.type,
+    payload: JSON.stringify(event),
+    qos: 1,
+    retain: false
+})), null];
@@ -0,0 +1,84 @@
+// Group lifecycle event stream: form, join, leave and dismantle events from the
+// statistics node plus periodic snapshots, numbered in one sequence. Events are
+// published on nsds_gm/events/<type> and the recent ones are retained, so a
+// consumer can resume from the last sequence number it saw through /events.
+const LOG_SIZE = parseInt(env.get('EVENT_LOG_SIZE') || '4096', 10);
+const SNAPSHOT_INTERVAL = 60000;  // Milliseconds between snapshot events
+const PAGE_SIZE = 1000;           // Events per /events response at most
+
+const stream = {
+    // Sequence numbers restart with the node, the epoch tells consumers apart
+    // a restart from a gap: positions are only comparable within an epoch
+    epoch: Date.now(),
+    seq: 0,
+    log: new Array(LOG_SIZE),     // Ring of the last LOG_SIZE events, by seq % LOG_SIZE
+    groups: null,                 // Latest group snapshot of the statistics node
+    fleet: null,
+    lastSnapshot: 0
+};
+
+// Function to number an event and retain it
+stream.append = function (event, now) {
+    event.epoch = stream.epoch;
+    event.seq = ++stream.seq;
+    event.time = now;
+    stream.log[event.seq % LOG_SIZE] = event;
+    return event;
+};
+
+// Function to describe the live groups, members and statistics included, so
+// that a consumer can rebuild its state from a snapshot alone
+stream.snapshot = function () {
+    const groups = {};
+    const snapshot = stream.groups || flow.get('groupSnapshot');
+    if (!snapshot) {
+        return { type: 'snapshot', groups: groups, fleet: stream.fleet };
+    }
+    snapshot.forEach((group, key) => {
+        if (group.members.length > 0) {
+            groups[key] = {
+                members: group.members.slice(),
+                cardinality: group.cardinality,
+                maximum: group.maximum,
+                minimum: group.minimum,
+                average: group.average,
+                variance: group.variance,
+                lifetime: group.lifetime
+            };
+        }
+    });
+    return { type: 'snapshot', groups: groups, fleet: stream.fleet };
+};
+
+// Function to number the events of a statistics update, adding a snapshot when
+// one is due. Returns the events to publish.
+stream.publish = function (events, now) {
+    const published = events.map(event => stream.append(event, now));
+    if (now - stream.lastSnapshot >= SNAPSHOT_INTERVAL) {
+        stream.lastSnapshot = now;
+        published.push(stream.append(stream.snapshot(), now));
+    }
+    return published;
+};
+
+// Function to answer a resume request: the events after since, or a snapshot
+// as of the current sequence when they are no longer retained or the epoch changed
+stream.since = function (epoch, since) {
+    const oldest = Math.max(1, stream.seq - LOG_SIZE + 1);
+    if (epoch !== stream.epoch || isNaN(since) || since < oldest - 1 || since > stream.seq) {
+        const snapshot = stream.snapshot();
+        snapshot.epoch = stream.epoch;
+        snapshot.seq = stream.seq;
+        snapshot.time = Date.now();
+        return { epoch: stream.epoch, seq: stream.seq, reset: true, events: [snapshot], more: false };
+    }
+
+    const last = Math.min(stream.seq, since + PAGE_SIZE);
+    const events = [];
+    for (let seq = since + 1; seq <= last; seq++) {
+        events.push(stream.log[seq % LOG_SIZE]);
+    }
+    return { epoch: stream.epoch, seq: stream.seq, reset: false, events: events, more: last < stream.seq };
+};
+
+context.set('stream', stream);
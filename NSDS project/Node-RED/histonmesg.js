@@ -0,0 +1,323 @@
+const WINDOW = 60000;                   // Rollup window in milliseconds
+const RETENTION = 24 * 60 * 60 * 1000;  // Rollups older than this are discarded
+// Every ARCHIVE_INTERVAL the points recorded since the previous pass are handed
+// to the store node, which appends them to its history journal, so a crash
+// loses at most that much history. A timeline is cut in memory once it holds
+// ARCHIVE_SLACK past the retention; its old points stay in the journal.
+const ARCHIVE_SLACK = 60 * 60 * 1000;
+const ARCHIVE_INTERVAL = 60000;         // Milliseconds between archive passes
+
+const history = context.get('history');
+const now = Date.now();
+
+// Helper functions for the timeline encoding: unsigned LEB128 varints, zigzag for signed deltas
+function writeVarint(tl, value) {
+    if (tl.len + 10 > tl.buf.length) {
+        const grown = new Uint8Array(tl.buf.length * 2);
+        grown.set(tl.buf.subarray(0, tl.len));
+        tl.buf = grown;
+    }
+    while (value >= 0x80) {
+        tl.buf[tl.len++] = (value % 0x80) | 0x80;
+        value = Math.floor(value / 0x80);
+    }
+    tl.buf[tl.len++] = value;
+}
+
+function zigzag(n) {
+    return n >= 0 ? n * 2 : -n * 2 - 1;
+}
+
+function unzigzag(n) {
+    return n % 2 === 0 ? n / 2 : -(n + 1) / 2;
+}
+
+// Function to decode a timeline into [time, cardinality] points
+function decodeTimeline(tl) {
+    const points = [];
+    let pos = 0;
+    let t = tl.base;
+    let card = 0;
+
+    function readVarint() {
+        let value = 0;
+        let scale = 1;
+        let byte;
+        do {
+            byte = tl.buf[pos++];
+            value += (byte & 0x7f) * scale;
+            scale *= 0x80;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    while (pos < tl.len) {
+        t += readVarint();
+        card += unzigzag(readVarint());
+        points.push([t, card]);
+    }
+    return points;
+}
+
+// Function to add a closed segment [from, to) with a constant cardinality to the rollups
+function addToRollups(key, from, to, card) {
+    for (let w = Math.floor(from / WINDOW); w * WINDOW < to; w++) {
+        const overlap = Math.min(to, (w + 1) * WINDOW) - Math.max(from, w * WINDOW);
+        let win = history.windows.get(w);
+        if (!win) {
+            win = { area: 0, alive: 0, maximum: 0, minimum: Infinity, keys: new Set() };
+            history.windows.set(w, win);
+            history.oldest = Math.min(history.oldest, w);
+        }
+        win.area += card * overlap;
+        win.alive += overlap;
+        win.maximum = Math.max(win.maximum, card);
+        win.minimum = Math.min(win.minimum, card);
+        win.keys.add(key);
+    }
+}
+
+function pruneRollups() {
+    const limit = Math.floor((now - RETENTION) / WINDOW);
+    while (history.oldest < limit) {
+        history.windows.delete(history.oldest);
+        history.oldest++;
+    }
+}
+
+// Function to encode [time, cardinality] points into a fresh timeline from base
+function encodeTimeline(base, points, lastT, lastCard) {
+    const tl = { base: base, buf: new Uint8Array(Math.max(16, 4 * points.length)), len: 0,
+                 lastT: lastT, lastCard: lastCard };
+    let t = base;
+    let card = 0;
+    points.forEach(([time, value]) => {
+        writeVarint(tl, time - t);
+        writeVarint(tl, zigzag(value - card));
+        t = time;
+        card = value;
+    });
+    return tl;
+}
+
+// Function to cut the timelines older than the retention. The cut starts the
+// kept part with the cardinality the group had then, so queries within the
+// retention are unchanged.
+function trimTimelines() {
+    const cut = now - RETENTION;
+
+    history.timelines.forEach((tl, key) => {
+        if (tl.base >= cut - ARCHIVE_SLACK) {
+            return;
+        }
+        const points = decodeTimeline(tl);
+        let i = 0;
+        let card = 0;
+        while (i < points.length && points[i][0] < cut) {
+            card = points[i++][1];
+        }
+        if (i === points.length && card === 0) {
+            history.timelines.delete(key); // Dismantled before the cut
+        } else {
+            const kept = points.slice(i);
+            if (card !== 0) {
+                kept.unshift([cut, card]);
+            }
+            history.timelines.set(key, encodeTimeline(cut, kept, tl.lastT, tl.lastCard));
+        }
+    });
+}
+
+// Function to hand the points recorded since the last pass to the store node
+function takeJournal() {
+    const entries = [];
+    history.journal.forEach((points, key) => entries.push({ key: key, points: points }));
+    history.journal.clear();
+    return entries;
+}
+
+// Function to record a new cardinality for a group at a given time, returns
+// whether it changed
+function recordCardinality(key, card, time) {
+    let tl = history.timelines.get(key);
+    if (!tl) {
+        tl = encodeTimeline(time, [], time, 0);
+        history.timelines.set(key, tl);
+    }
+    if (card === tl.lastCard || time < tl.lastT) {
+        return false;
+    }
+    if (tl.lastCard > 0) {
+        addToRollups(key, tl.lastT, time, tl.lastCard);
+    }
+    writeVarint(tl, time - tl.lastT);
+    writeVarint(tl, zigzag(card - tl.lastCard));
+    tl.lastT = time;
+    tl.lastCard = card;
+
+    if (card > 0) {
+        history.open.add(key);
+    } else {
+        history.open.delete(key);
+    }
+    return true;
+}
+
+// Function to record a change of the running backend, journaled at the next pass
+function recordChange(key, card) {
+    if (recordCardinality(key, card, now)) {
+        if (!history.journal.has(key)) {
+            history.journal.set(key, []);
+        }
+        history.journal.get(key).push([now, card]);
+    }
+}
+
+// Function to replay the journal of the previous runs, within the retention.
+// The groups alive when it was last written are closed there, the time the
+// backend was down is not theirs, and open again now with the cardinality the
+// store recovered.
+function restoreHistory() {
+    const archive = flow.get('historyArchive');
+    history.restored = true;
+    if (!archive) {
+        return;
+    }
+    archive.read(now - RETENTION).forEach(entry => {
+        entry.points.forEach(([time, card]) => recordCardinality(entry.key, card, time));
+    });
+    [...history.open].forEach(key => recordCardinality(key, 0, Math.min(archive.lastWrite, now)));
+    const groups = flow.get('groups') || {};
+    Object.keys(groups).forEach(key => {
+        if (groups[key].cardinality > 0) {
+            recordChange(key, groups[key].cardinality);
+        }
+    });
+    pruneRollups();
+}
+
+// Function to compute the cardinality of a group at time t
+function cardinalityAt(key, t) {
+    const tl = history.timelines.get(key);
+    let card = 0;
+    if (!tl) {
+        return 0;
+    }
+    for (const [time, value] of decodeTimeline(tl)) {
+        if (time > t) {
+            break;
+        }
+        card = value;
+    }
+    return card;
+}
+
+// Query: time-weighted average size of one group, or of all alive groups, in [t1, t2]
+function averageSize(t1, t2, key) {
+    let area = 0;
+    let alive = 0;
+
+    if (key !== undefined) {
+        const tl = history.timelines.get(key);
+        if (!tl) {
+            return null;
+        }
+        const points = decodeTimeline(tl);
+        points.push([now, tl.lastCard]);
+        for (let i = 0; i + 1 < points.length; i++) {
+            const from = Math.max(points[i][0], t1);
+            const to = Math.min(points[i + 1][0], t2);
+            if (to > from && points[i][1] > 0) {
+                area += points[i][1] * (to - from);
+                alive += to - from;
+            }
+        }
+        return { group: key, t1: t1, t2: t2, average: alive > 0 ? area / alive : 0, alive_ms: alive };
+    }
+
+    // Whole windows from the rollups, plus the segments still open
+    const w1 = Math.floor(t1 / WINDOW);
+    const w2 = Math.ceil(t2 / WINDOW);
+    for (let w = w1; w < w2; w++) {
+        const win = history.windows.get(w);
+        if (win) {
+            area += win.area;
+            alive += win.alive;
+        }
+    }
+    history.open.forEach(k => {
+        const tl = history.timelines.get(k);
+        const overlap = Math.min(now, w2 * WINDOW) - Math.max(tl.lastT, w1 * WINDOW);
+        if (overlap > 0) {
+            area += tl.lastCard * overlap;
+            alive += overlap;
+        }
+    });
+    return { t1: w1 * WINDOW, t2: w2 * WINDOW, average: alive > 0 ? area / alive : 0, alive_ms: alive };
+}
+
+// Query: groups alive at time t with their cardinality
+function aliveAt(t) {
+    const candidates = new Set(history.open);
+    const win = history.windows.get(Math.floor(t / WINDOW));
+    if (win) {
+        win.keys.forEach(k => candidates.add(k));
+    }
+
+    const groups = {};
+    candidates.forEach(k => {
+        const card = cardinalityAt(k, t);
+        if (card > 0) {
+            groups[k] = card;
+        }
+    });
+    return { t: t, groups: groups };
+}
+
+// Function to answer a GET /history request
+function handleQuery(query) {
+    const t1 = Number(query.t1);
+    const t2 = query.t2 !== undefined ? Number(query.t2) : now;
+    const t = query.t !== undefined ? Number(query.t) : now;
+
+    switch (query.op) {
+        case 'average':
+            return isNaN(t1) || isNaN(t2) ? null : averageSize(t1, t2, query.group);
+        case 'alive':
+            return isNaN(t) ? null : aliveAt(t);
+        case 'timeline': {
+            const tl = history.timelines.get(query.group);
+            return tl ? { group: query.group, points: decodeTimeline(tl) } : null;
+        }
+        default:
+            return null;
+    }
+}
+
+if (!history.restored) {
+    restoreHistory();
+}
+
+// HTTP queries are answered directly, group updates feed the timelines
+if (msg.req) {
+    const result = handleQuery(msg.req.query || {});
+    msg.statusCode = result ? 200 : 400;
+    msg.payload = result || { error: 'usage: op=average&t1=&t2=[&group=] | op=alive&t= | op=timeline&group=' };
+    return msg;
+}
+
+(msg.changed || []).forEach(key => {
+    const group = msg.payload.get(key);
+    recordChange(key, group ? group.cardinality : 0);
+});
+pruneRollups();
+
+if (now >= history.nextArchive) {
+    history.nextArchive = now + ARCHIVE_INTERVAL;
+    trimTimelines();
+    const journaled = takeJournal();
+    if (journaled.length > 0) {
+        return [null, { archive: journaled }];
+    }
+}
+return null;
@@ -0,0 +1,13 @@
+// Cardinality history of every group: a delta/varint encoded timeline per group
+// and time-weighted rollups per window, kept up to date as the groups change.
+// The changes are also journaled to disk by the store node, and the retained
+// part of the journal is replayed with the first message after a restart.
+context.set('history', {
+    timelines: new Map(),  // Group key -> compressed timeline
+    windows: new Map(),    // Window index -> rollup of the closed segments in it
+    open: new Set(),       // Keys of the groups alive right now
+    oldest: Infinity,      // Oldest window index still retained
+    journal: new Map(),    // Group key -> points recorded since the last archive pass
+    restored: false,       // Whether the journal of the previous runs was replayed
+    nextArchive: 0         // Time of the next pass journaling and trimming the timelines
+});
@@ -0,0 +1,51 @@
+const index = context.get('index');
+const now = Date.now();
+
+// Function to answer a GET /groups request: undefined when malformed, null
+// for a group that does not exist
+function handleQuery(query) {
+    const k = Math.min(parseInt(query.top || query.oldest, 10) || 10, 1000);
+    if (query.node !== undefined) {
+        return index.node(query.node, now);
+    }
+    if (query.group !== undefined) {
+        return index.describe(query.group, now);
+    }
+    if (query.top !== undefined) {
+        return { top: index.top(k, now) };
+    }
+    if (query.oldest !== undefined) {
+        return { oldest: index.oldest(k, now) };
+    }
+    return undefined;
+}
+
+if (msg.req) {
+    const result = handleQuery(msg.req.query || {});
+    msg.statusCode = result === undefined ? 400 : (result === null ? 404 : 200);
+    msg.payload = result === undefined ? { error: 'usage: node=<address> | top=<k> | oldest=<k> | group=<key>' } :
+                  (result === null ? { error: 'no such group' } : result);
+    return msg;
+}
+
+// Membership changes from the statistics node
+index.groups = msg.payload;
+if (!index.seeded) {
+    index.seed(msg.payload);
+}
+// Additions first: a mote moving between groups is overwritten in place
+// rather than deleted and added back, which V8 Maps handle poorly
+const membership = msg.membership || [];
+membership.forEach(change => {
+    change.added.forEach(address => index.nodeGroup.set(address, change.group));
+});
+membership.forEach(change => {
+    change.removed.forEach(address => {
+        if (index.nodeGroup.get(address) === change.group) {
+            index.nodeGroup.delete(address);
+        }
+    });
+});
+(msg.changed || []).forEach(key => index.update(key, msg.payload.get(key)));
+
+return null;
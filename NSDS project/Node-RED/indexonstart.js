@@ -0,0 +1,116 @@
+// Read model of the groups for operator queries, kept up to date from the
+// membership changes of every statistics message, so a query never scans the
+// groups nor waits on the ingest path. Served at /groups:
+//   ?node=<address>   group of a mote
+//   ?top=<k>          k largest groups
+//   ?oldest=<k>       k longest-lived groups
+//   ?group=<key>      one group
+const index = {
+    groups: null,            // Latest group snapshot from the statistics node
+    nodeGroup: new Map(),    // Mote address -> key of its group
+    bySize: [],              // Size -> keys of the groups of that size
+    size: new Map(),         // Group key -> its size in bySize
+    largest: 0,              // Largest size with a group, bySize is empty above it
+    formed: new Map(),       // Group key -> formation time, in formation order
+    seeded: false
+};
+
+// Function to move a group to its new size in the size index, 0 removes it
+index.resize = function (key, size) {
+    const old = index.size.get(key);
+    if (old === size) {
+        return;
+    }
+    if (old !== undefined) {
+        index.bySize[old].delete(key);
+        index.size.delete(key);
+    }
+    if (size > 0) {
+        while (index.bySize.length <= size) {
+            index.bySize.push(new Set());
+        }
+        index.bySize[size].add(key);
+        index.size.set(key, size);
+        index.largest = Math.max(index.largest, size);
+    }
+    while (index.largest > 0 && index.bySize[index.largest].size === 0) {
+        index.largest--;
+    }
+};
+
+// Function to bring one group up to date in every index
+index.update = function (key, group) {
+    const size = group ? group.members.length : 0;
+    index.resize(key, size);
+    if (size === 0) {
+        index.formed.delete(key);
+    } else if (!index.formed.has(key)) {
+        // Groups form in time order, so insertion order is age order
+        index.formed.set(key, group.timestamp);
+    }
+};
+
+// Function to index the groups recovered by the store, before the first change
+index.seed = function (snapshot) {
+    const live = [];
+    snapshot.forEach((group, key) => {
+        if (group.members.length > 0) {
+            live.push(key);
+        }
+    });
+    live.sort((a, b) => snapshot.get(a).timestamp - snapshot.get(b).timestamp)
+        .forEach(key => {
+            snapshot.get(key).members.forEach(address => index.nodeGroup.set(address, key));
+            index.update(key, snapshot.get(key));
+        });
+    index.seeded = true;
+};
+
+// Function to describe a group for a query answer
+function describe(key, now) {
+    const group = index.groups && index.groups.get(key);
+    if (!group || group.members.length === 0) {
+        return null;
+    }
+    return {
+        group: key,
+        generation: group.generation || 0,
+        cardinality: group.members.length,
+        age: (now - group.timestamp) / 1000,
+        members: group.members
+    };
+}
+
+// Query: k largest groups, walking the size buckets down from the largest
+index.top = function (k, now) {
+    const result = [];
+    for (let size = index.largest; size > 0 && result.length < k; size--) {
+        for (const key of index.bySize[size]) {
+            if (result.length === k) {
+                break;
+            }
+            result.push(describe(key, now));
+        }
+    }
+    return result;
+};
+
+// Query: k longest-lived groups, the first ones formed
+index.oldest = function (k, now) {
+    const result = [];
+    for (const key of index.formed.keys()) {
+        if (result.length === k) {
+            break;
+        }
+        result.push(describe(key, now));
+    }
+    return result;
+};
+
+index.node = function (address, now) {
+    const key = index.nodeGroup.get(address);
+    return { node: address, group: key === undefined ? null : describe(key, now) };
+};
+
+index.describe = describe;
+context.set('index', index);
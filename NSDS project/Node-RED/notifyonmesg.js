@@ -0,0 +1,33 @@
+const notify = context.get('notify');
+const now = Date.now();
+const membership = msg.membership || [];
+
+// A mote moving between groups (two groups merging) is removed from one and
+// added to the other in the same message, in either order: it only gets the
+// parameters of its new group
+const added = new Set();
+membership.forEach(change => change.added.forEach(address => added.add(address)));
+
+membership.forEach(change => {
+    // Motes that left a group go back to the beacon period and contact timeout
+    // of their profile. They are then forgotten, so the map only holds the
+    // members of the groups.
+    change.removed.forEach(address => {
+        if (!added.has(address)) {
+            notify.push(address, 0, notify.BEACON_DEFAULT);
+            notify.sent.delete(address);
+        }
+    });
+});
+
+membership.forEach(change => {
+    const group = msg.payload.get(change.group);
+    if (group && group.members.length > 0) {
+        notify.lastChange.set(change.group, now);
+        notify.pushGroup(change.group, now);
+    } else {
+        notify.lastChange.delete(change.group);
+    }
+});
+
+return null;
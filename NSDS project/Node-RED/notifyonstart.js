@@ -0,0 +1,59 @@
+// Downlink to the motes: group assignments and beacon tuning, 4 bytes per mote
+// (see common/notify.h). Groups whose membership keeps changing get fast
+// beacons; groups that have been stable for a while get slow ones.
+const NOTIFY_VERSION = 1;
+const STABLE_AFTER = 120000;    // Milliseconds without membership change before a group is stable
+const CHECK_INTERVAL = 10000;   // Milliseconds between checks for newly stable groups
+const BEACON_DYNAMIC = 10;      // Seconds
+const BEACON_DEFAULT = 0xff;    // NOTIFY_COMPILED_DEFAULT: the motes go back to their profile's defaults
+const BEACON_STABLE = 40;       // Seconds
+
+const notify = {
+    sent: new Map(),        // Mote address -> last parameters sent, to skip repeats
+    lastChange: new Map(),  // Group key -> time of the last membership change, until stable
+    timer: null
+};
+
+// Function to send parameters to a mote, unless it already has them
+notify.push = function (address, group, beacon) {
+    const timeout = beacon === BEACON_DEFAULT ? BEACON_DEFAULT : 3 * beacon;
+    const code = (group << 16) | (beacon << 8) | timeout;
+    if (notify.sent.get(address) === code) {
+        return;
+    }
+    notify.sent.set(address, code);
+    node.send({
+        topic: 'nsds_gm/notify/' + address,
+        payload: Buffer.from([NOTIFY_VERSION, group, beacon, timeout]),
+        qos: 0,
+        retain: false
+    });
+};
+
+// Function to send the parameters of a group to all its members
+notify.pushGroup = function (groupKey, now) {
+    const snapshot = flow.get('groupSnapshot');
+    const group = snapshot && snapshot.get(groupKey);
+    if (!group) {
+        return;
+    }
+    const changed = notify.lastChange.get(groupKey);
+    const beacon = changed !== undefined && now - changed < STABLE_AFTER ? BEACON_DYNAMIC : BEACON_STABLE;
+    const slot = parseInt(groupKey.slice('group'.length), 10);
+    group.members.forEach(address => notify.push(address, slot, beacon));
+};
+
+// Function to slow down the groups that became stable
+notify.check = function () {
+    const now = Date.now();
+    notify.lastChange.forEach((changed, groupKey) => {
+        if (now - changed >= STABLE_AFTER) {
+            notify.lastChange.delete(groupKey);
+            notify.pushGroup(groupKey, now);
+        }
+    });
+};
+
+notify.BEACON_DEFAULT = BEACON_DEFAULT;
+notify.timer = setInterval(notify.check, CHECK_INTERVAL);
+context.set('notify', notify);
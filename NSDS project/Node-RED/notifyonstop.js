@@ -0,0 +1,7 @@
+// Stop checking for stable groups
+const notify = context.get('notify');
+
+if (notify) {
+    clearInterval(notify.timer);
+    context.set('notify', undefined);
+}
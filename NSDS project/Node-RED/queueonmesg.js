@@ -0,0 +1,13 @@
+const queue = context.get('queue');
+
+// Queue-depth and duplicate metrics, served at /ingest
+if (msg.req) {
+    msg.payload = Object.assign({}, flow.get('dedup'), queue.metrics);
+    msg.statusCode = 200;
+    return [null, msg];
+}
+
+queue.enqueue(msg, Date.now());
+queue.schedule();
+
+return null;
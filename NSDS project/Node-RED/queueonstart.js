@@ -0,0 +1,142 @@
+// Bounded ingest queue between the Cooja input and the statistics node.
+// Departures go ahead of group reports, a sender's pending report is replaced
+// by its newer one, and when the queue is full the oldest report is shed, so
+// a reconnection burst costs bounded memory and bounded queueing delay.
+//
+// Ordering: a mote's messages leave in the order they arrived, except that a
+// departure goes ahead of the mote's queued report (which drops the departed
+// contact) and a newer report takes the place of the queued one. Both uplinks already deliver a mote's messages in order, the MQTT
+// one over the mote's TCP session and the UDP one with a single event in
+// flight, so they are not reordered by sequence number here. Messages of
+// different motes leave in arrival order within their priority, nothing more.
+const CAPACITY = parseInt(env.get('INGEST_QUEUE_SIZE') || '1024', 10);
+const DRAIN_BATCH = 64;  // Messages handed downstream before yielding to the event loop
+
+// Fixed-size ring of queue entries
+function createRing(capacity) {
+    return { items: new Array(capacity), head: 0, size: 0 };
+}
+
+function ringPush(ring, entry) {
+    ring.items[(ring.head + ring.size) % ring.items.length] = entry;
+    ring.size++;
+}
+
+function ringShift(ring) {
+    const entry = ring.items[ring.head];
+    ring.items[ring.head] = undefined;
+    ring.head = (ring.head + 1) % ring.items.length;
+    ring.size--;
+    return entry;
+}
+
+const queue = {
+    high: createRing(CAPACITY),     // Departures
+    normal: createRing(CAPACITY),   // Group reports
+    pending: new Map(),             // Sender -> its queued report entry
+    scheduled: null,
+    metrics: {
+        capacity: CAPACITY,
+        depth: 0,
+        maxDepth: 0,
+        enqueued: 0,
+        delivered: 0,
+        coalesced: 0,
+        shed: 0,
+        maxWait: 0,     // Milliseconds
+        avgWait: 0      // Milliseconds, moving average
+    }
+};
+
+// Function to drop the oldest queued report to make room, false if there is none
+function shedReport() {
+    if (queue.normal.size === 0) {
+        return false;
+    }
+    const entry = ringShift(queue.normal);
+    queue.pending.delete(entry.msg.payload.sender);
+    queue.metrics.shed++;
+    return true;
+}
+
+// Function to add a message, applying coalescing and load shedding
+queue.enqueue = function (msg, now) {
+    const payload = msg.payload;
+    const metrics = queue.metrics;
+    const pending = queue.pending.get(payload.sender);
+    metrics.enqueued++;
+
+    if (payload.event === 'departure') {
+        // A queued report from the same mote predates the departure
+        if (pending) {
+            pending.msg.payload.contacts = pending.msg.payload.contacts.filter(id => id !== payload.ip);
+        }
+        if (metrics.depth === CAPACITY && !shedReport()) {
+            metrics.shed++;
+            return;
+        }
+        ringPush(queue.high, { msg: msg, time: now });
+    } else if (pending) {
+        // The newer report supersedes the queued one and keeps its place
+        pending.msg = msg;
+        metrics.coalesced++;
+        return;
+    } else {
+        if (metrics.depth === CAPACITY && !shedReport()) {
+            metrics.shed++;
+            return;
+        }
+        const entry = { msg: msg, time: now };
+        ringPush(queue.normal, entry);
+        queue.pending.set(payload.sender, entry);
+    }
+    metrics.depth = queue.high.size + queue.normal.size;
+    metrics.maxDepth = Math.max(metrics.maxDepth, metrics.depth);
+};
+
+// Function to take the next message, departures first
+queue.dequeue = function (now) {
+    const ring = queue.high.size > 0 ? queue.high : queue.normal;
+    if (ring.size === 0) {
+        return null;
+    }
+    const entry = ringShift(ring);
+    if (ring === queue.normal) {
+        queue.pending.delete(entry.msg.payload.sender);
+    }
+
+    const metrics = queue.metrics;
+    const wait = now - entry.time;
+    metrics.depth = queue.high.size + queue.normal.size;
+    metrics.delivered++;
+    metrics.maxWait = Math.max(metrics.maxWait, wait);
+    metrics.avgWait += (wait - metrics.avgWait) / 16;
+    return entry.msg;
+};
+
+// Function to make sure a drain is on its way
+queue.schedule = function () {
+    if (queue.scheduled === null && queue.metrics.depth > 0) {
+        queue.scheduled = setTimeout(queue.drain, 0);
+    }
+};
+
+// Function to hand queued messages downstream in batches, yielding in between
+// so that the statistics node runs before the next batch is released
+queue.drain = function () {
+    queue.scheduled = null;
+    const now = Date.now();
+    for (let n = 0; n < DRAIN_BATCH; n++) {
+        const msg = queue.dequeue(now);
+        if (msg === null) {
+            break;
+        }
+        node.send(msg);
+    }
+    node.status({ text: 'depth ' + queue.metrics.depth + ', shed ' + queue.metrics.shed });
+    if (queue.metrics.depth > 0) {
+        queue.scheduled = setTimeout(queue.drain, 0);
+    }
+};
+
+context.set('queue', queue);
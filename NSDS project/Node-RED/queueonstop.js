@@ -0,0 +1,7 @@
+// Stop draining, queued messages are dropped with the node
+const queue = context.get('queue');
+
+if (queue && queue.scheduled !== null) {
+    clearTimeout(queue.scheduled);
+    queue.scheduled = null;
+}
@@ -1,204 +1,651 @@
-// Helper function to update group statistics
+// Keys of the groups modified by this message, persisted by the store node
+const changedGroups = new Set();
+const now = Date.now();
+
+// Fleet-wide sketch of the group sizes: exact buckets for small groups,
+// logarithmic buckets 2% wide (SKETCH_GAMMA) above SKETCH_EXACT. A quantile
+// there is read at the geometric middle of its bucket, within 1% of the true
+// size, up to the last bucket (about 10000 members).
+const SKETCH_EXACT = 64;
+const SKETCH_GAMMA = 1.02;
+const sizeSketch = flow.get('sizeSketch');
+// Seconds added to the sketch by this message, by group size, persisted by the
+// store node with the groups so the quantiles survive a restart
+const sizeSeconds = {};
+
+// Member addresses are interned to integers, groups are compared as sorted
+// vectors of those integers cached next to the (persisted) member lists
+const interned = flow.get('memberIds');
+const vectors = context.get('memberVectors');
+// Added and removed members of every group touched by this message
+const membershipChanges = [];
+// Typed lifecycle events of this message (form, join, leave, dismantle), in
+// the order they happened, numbered by the event stream node
+const lifecycleEvents = [];
+// Global contact graph built from the partial views reported by the motes
+const graph = flow.get('contactGraph');
+// Minimum number of mutually connected motes forming a group
+const MIN_GROUP_SIZE = 3;
+// A member silent for this long has its report dropped, as if it had left its
+// contacts: the motes report at least once per beacon period (40 s when stable)
+const MEMBER_TIMEOUT = 120000;
+// A mote nobody reported about for this long, outside any group, gives its
+// slot in the intern table and the graph back to the pool
+const EVICT_AFTER = 3600000;
+// Groups recovered by the store wait this long after the seeding for the
+// members that have not reported yet, instead of being dismantled by the
+// first report, which only names the sender's contacts
+const RECOVERY_GRACE = MEMBER_TIMEOUT;
+const SWEEP_INTERVAL = 10000;
+
+// Helper function to build an empty group slot
+function emptyGroup(name, generation) {
+    return {
+        name: name,
+        generation: generation,
+        members: [],
+        cardinality: 0,
+        maximum: 0,
+        minimum: 0,
+        average: 0,
+        variance: 0,
+        index: 0,
+        timestamp: now,
+        lifetime: 0,
+        dismantle_timer: now,
+        last_change: now,
+        weight: 0,
+        sum: 0,
+        sum_squares: 0
+    };
+}
+
+// Helper function to add time spent at a given size to the fleet sketch
+function addToSketch(size, seconds) {
+    let bucket = size;
+    if (size > SKETCH_EXACT) {
+        bucket = SKETCH_EXACT + Math.ceil(Math.log(size / SKETCH_EXACT) / Math.log(SKETCH_GAMMA));
+    }
+    sizeSketch[Math.min(bucket, sizeSketch.length - 1)] += seconds;
+}
+
+// Helper function to read a quantile (0..1) of the time-weighted group size from the sketch
+function sketchQuantile(q) {
+    let total = 0;
+    for (let i = 0; i < sizeSketch.length; i++) {
+        total += sizeSketch[i];
+    }
+    if (total === 0) {
+        return 0;
+    }
+    let rank = q * total;
+    for (let i = 0; i < sizeSketch.length; i++) {
+        rank -= sizeSketch[i];
+        if (rank <= 0) {
+            return i <= SKETCH_EXACT ? i : SKETCH_EXACT * Math.pow(SKETCH_GAMMA, i - SKETCH_EXACT - 0.5);
+        }
+    }
+    return sizeSketch.length - 1;
+}
+
+// Helper function to close the segment since the last change of cardinality.
+// A cardinality holds until the next change, so the statistics are weighted by
+// time and do not depend on how often the motes report.
+function accumulate(group) {
+    const seconds = (now - group.last_change) / 1000;
+    if (seconds > 0 && group.cardinality > 0) {
+        group.weight += seconds;
+        group.sum += group.cardinality * seconds;
+        group.sum_squares += group.cardinality * group.cardinality * seconds;
+        addToSketch(group.cardinality, seconds);
+        sizeSeconds[group.cardinality] = (sizeSeconds[group.cardinality] || 0) + seconds;
+    }
+    group.last_change = now;
+}
+
+// Helper function to refresh the derived statistics, including the open segment
+function refreshStatistics(group) {
+    const open = group.cardinality > 0 ? (now - group.last_change) / 1000 : 0;
+    const weight = group.weight + open;
+    const c = group.cardinality;
+
+    if (weight > 0) {
+        group.average = (group.sum + c * open) / weight;
+        group.variance = Math.max(0, (group.sum_squares + c * c * open) / weight - group.average * group.average);
+    } else {
+        group.average = c;
+        group.variance = 0;
+    }
+    group.lifetime = (now - group.timestamp) / 1000;
+}
+
+// Helper function to update group statistics, only when the cardinality changes
 function updateGroupStatistics(group, newCardinality) {
-    group.cardinality = newCardinality;
-    group.lifetime = (Date.now() - group.timestamp) / 1000;
+    if (newCardinality === group.cardinality) {
+        refreshStatistics(group);
+        return false;
+    }
+    accumulate(group);
 
     // Update max, min, and average cardinalities
+    group.cardinality = newCardinality;
     group.maximum = Math.max(group.maximum, newCardinality);
-    group.minimum = Math.min(group.minimum || Infinity, newCardinality);
-    group.average = ((group.average * group.index) + newCardinality) / (group.index + 1);
+    group.minimum = group.index === 0 ? newCardinality : Math.min(group.minimum, newCardinality);
     group.index += 1;
+    refreshStatistics(group);
+    return true;
 }
 
 
-// Function to handle the periodic monitoring of groups and timeouts
-function periodicGroupMonitoring() {
-    const groups = context.get('groups') || {};
-    const now = Date.now();
-    const timeoutThreshold = 60000; // Timeout threshold in milliseconds (e.g., 1 minute)
+// Helper function to sort an ID vector in place, dropping duplicates and the given ID
+function normalize(vector, except) {
+    vector.sort();
 
-    Object.keys(groups).forEach(groupKey => {
-        const group = groups[groupKey];
-        
-        // Filter out members who have timed out
-        group.members = group.members.filter(member => 
-            now - (member.lastActive || group.timestamp) < timeoutThreshold
-        );
-
-        // Update statistics if group cardinality has changed
-        const newCardinality = group.members.length;
-        if (newCardinality !== group.cardinality) {
-            updateGroupStatistics(group, newCardinality);
-        }
-        
-        // Check if group should be dismantled due to low cardinality
-        if (group.cardinality < 3) {
-            dismantleGroup(groupKey, groups);
-        } else {
-            // Update group's lifetime
-            group.lifetime = (now - group.timestamp) / 1000;
+    let n = 0;
+    for (let i = 0; i < vector.length; i++) {
+        if (vector[i] !== except && (n === 0 || vector[i] !== vector[n - 1])) {
+            vector[n++] = vector[i];
         }
-    });
+    }
+    return vector.subarray(0, n);
+}
 
-    context.set('groups', groups);
+// Helper function to build the sorted, duplicate-free ID vector of a member
+// list, leaving out the addresses the full pool could not take
+function toVector(members) {
+    const vector = new Uint32Array(members.length);
+    let n = 0;
+    for (let i = 0; i < members.length; i++) {
+        const id = interned.intern(members[i]);
+        if (id >= 0) {
+            vector[n++] = id;
+        }
+    }
+    return normalize(vector.subarray(0, n), -1);
 }
 
-// Function to dismantle a group
-function dismantleGroup(groupKey, groups) {
-    // Log a warning or perform other needed dismantling logic
-    node.warn(`Group ${groupKey} has been dismantled due to insufficient members.`);
-    groups[groupKey] = {
-        members: [],
-        cardinality: 0,
-        maximum: 0,
-        minimum: 0,
-        average: 0,
-        index: 0,
-        timestamp: Date.now(),
-        lifetime: 0,
-        dismantle_timer: Date.now()
-    };
+// Helper function to get the cached ID vector of a group, rebuilt when the
+// group object was replaced (new group, dismantle or store recovery)
+function groupVector(group) {
+    let vector = vectors.get(group);
+    if (vector === undefined) {
+        vector = toVector(group.members);
+        vectors.set(group, vector);
+    }
+    return vector;
 }
 
-// Function to update a group when a message is received
-function processGroupMemberships(cooja_result) {
-    const groups = context.get('groups') || {};
-    const now = Date.now();
-    
-    // Find or create groups for the sender
-    let existingGroups = checkSenderInGroups(cooja_result);
-    
-    existingGroups.forEach(group => {
-        // Update last active time for each member
-        group.members.forEach(member => {
-            if (member.id === cooja_result.sender) {
-                member.lastActive = now;
-            }
-        });
+// Helper function to look up an ID in a sorted vector
+function vectorHas(vector, id) {
+    let lo = 0;
+    let hi = vector.length - 1;
+    while (lo <= hi) {
+        const mid = (lo + hi) >>> 1;
+        if (vector[mid] === id) {
+            return true;
+        }
+        if (vector[mid] < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return false;
+}
+
+// Helper function to diff two sorted vectors with a linear merge, returning IDs
+function diffVectors(before, after) {
+    const added = [];
+    const removed = [];
+    let i = 0;
+    let j = 0;
 
-        // Check if current members match the new member list
-        if (!arraysEqual(group.members.map(m => m.id).sort(), cooja_result.members.sort())) {
-            // Members have changed, update the group
-            group.members = cooja_result.members.map(id => ({ id, lastActive: now }));
-            updateGroupStatistics(group, group.members.length);
+    while (i < before.length || j < after.length) {
+        if (j === after.length || (i < before.length && before[i] < after[j])) {
+            removed.push(before[i++]);
+        } else if (i === before.length || after[j] < before[i]) {
+            added.push(after[j++]);
+        } else {
+            i++;
+            j++;
         }
-        // Otherwise, the group remains unchanged so no need to update statistics
-    });
-    
-    context.set('groups', groups);
+    }
+    return { added: added, removed: removed };
 }
 
-// Function to check if the sender is in any group and return those groups
-function checkSenderInGroups(cooja_result) {
-    const groups = context.get('groups');
-    let memberGroups = [];
+// Helper function to map member IDs back to their addresses
+function namesOf(ids) {
+    const names = new Array(ids.length);
+    for (let i = 0; i < ids.length; i++) {
+        names[i] = interned.name(ids[i]);
+    }
+    return names;
+}
 
-    // Check all groups to see if sender is a member
-    Object.keys(groups).forEach(groupKey => {
-        if (groups[groupKey].members.includes(cooja_result.sender)) {
-            memberGroups.push(groups[groupKey]);
+// Helper function to add a mote to the contact graph. The graph is indexed by
+// the slot of the mote's handle; edges, components and groups hold slots, only
+// the reports hold handles, as they may outlive the motes they name.
+function addVertex(handle) {
+    const id = interned.slot(handle);
+    if (graph.parent[id] === undefined) {
+        graph.parent[id] = id;
+        graph.component[id] = [id];
+        graph.adjacency[id] = new Set();
+        graph.reports[id] = new Uint32Array(0);
+        graph.lastSeen[id] = now;
+    }
+    return id;
+}
+
+// Helper function to give the slot of an evicted mote back to the pool. Only
+// motes without edges are evicted, which makes their component a singleton.
+function removeVertex(id) {
+    graph.parent[id] = undefined;
+    graph.component[id] = undefined;
+    graph.adjacency[id] = undefined;
+    graph.reports[id] = undefined;
+    graph.group[id] = undefined;
+    graph.lastSeen[id] = 0;
+    graph.lastReport[id] = 0;
+    interned.release(interned.handle(id));
+    graph.evicted++;
+}
+
+// Helper function to tell whether a slot can be evicted: its mote has no edge,
+// no group and nobody reported about it since the given time. A slot interned
+// by the Cooja input node that never made it into the graph has no vertex.
+function evictable(id, before) {
+    const adjacency = graph.adjacency[id];
+    return interned.isLive(interned.handle(id)) && graph.group[id] === undefined &&
+           (adjacency === undefined || adjacency.size === 0) && graph.lastSeen[id] < before;
+}
+
+// Function to evict the motes idle for EVICT_AFTER. When the pool is full and
+// none is that old, the coldest mote whose own report timed out goes instead.
+// Returns whether a slot was freed.
+function evictIdle(time, underPressure) {
+    const end = interned.highWater();
+    let freed = 0;
+    let coldest = -1;
+    for (let id = 0; id < end; id++) {
+        if (graph.lastSeen[id] === 0 && graph.parent[id] === undefined &&
+            interned.isLive(interned.handle(id))) {
+            graph.lastSeen[id] = time; // Orphan slot, its idle time starts now
+        } else if (evictable(id, time - EVICT_AFTER)) {
+            removeVertex(id);
+            freed++;
+        } else if (underPressure && evictable(id, time - MEMBER_TIMEOUT) &&
+                   (coldest < 0 || graph.lastSeen[id] < graph.lastSeen[coldest])) {
+            coldest = id;
         }
-    });
+    }
+    if (freed === 0 && coldest >= 0) {
+        removeVertex(coldest);
+        freed++;
+    }
+    return freed > 0;
+}
+
+// Helper function to find the component of a mote (union-find with path halving)
+function find(id) {
+    const parent = graph.parent;
+    while (parent[id] !== id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+// Helper function to merge the components of two motes, smaller into larger
+function union(a, b) {
+    let ra = find(a);
+    let rb = find(b);
+    if (ra === rb) {
+        return;
+    }
+    if (graph.component[ra].length < graph.component[rb].length) {
+        [ra, rb] = [rb, ra];
+    }
+    for (const id of graph.component[rb]) {
+        graph.component[ra].push(id);
+    }
+    graph.parent[rb] = ra;
+    graph.component[rb] = undefined;
+}
 
-    if (memberGroups.length === 0) {
-        addNewGroup(cooja_result, groups);
+// Helper function to rebuild a component after edges were removed from it.
+// Union-find cannot split, so the component is traversed again; its size
+// bounds the cost and only departures pay it.
+function split(root) {
+    const members = graph.component[root];
+    const roots = [];
+    graph.component[root] = undefined;
+    for (const id of members) {
+        graph.parent[id] = -1;
     }
 
-    return memberGroups;
+    for (const start of members) {
+        if (graph.parent[start] !== -1) {
+            continue;
+        }
+        const component = [start];
+        graph.parent[start] = start;
+        for (let i = 0; i < component.length; i++) {
+            for (const next of graph.adjacency[component[i]]) {
+                if (graph.parent[next] === -1) {
+                    graph.parent[next] = start;
+                    component.push(next);
+                }
+            }
+        }
+        graph.component[start] = component;
+        roots.push(start);
+    }
+    return roots;
 }
 
-// Function to add a new group for the sender
-function addNewGroup(cooja_result, groups) {
-    for (let k = 1; k <= Object.keys(groups).length; k++) {
-        let groupKey = "group" + k;
-        if (groups[groupKey].members.length === 0) {
-            groups[groupKey].members = [...cooja_result.members, cooja_result.sender];
-            const newCardinality = groups[groupKey].members.length;
+// Function to apply the contacts reported by a mote to the graph.
+// An edge exists only when both motes report each other, and the work done
+// is proportional to the edges that changed: an unchanged report costs one merge.
+// Returns the roots of the components that may have changed.
+function applyReport(sender, reported) {
+    const from = addVertex(sender);
+    const diff = diffVectors(graph.reports[from], reported);
+    if (diff.added.length === 0 && diff.removed.length === 0) {
+        return [];
+    }
+    graph.reports[from] = reported;
+
+    let edgesRemoved = false;
+    for (const handle of diff.removed) {
+        // A stale handle names an evicted mote, whose edges are already gone
+        const id = interned.slot(handle);
+        if (interned.isLive(handle) && graph.adjacency[from].delete(id)) {
+            graph.adjacency[id].delete(from);
+            edgesRemoved = true;
+        }
+    }
+    for (const handle of diff.added) {
+        const id = addVertex(handle);
+        if (vectorHas(graph.reports[id], sender)) {
+            graph.adjacency[from].add(id);
+            graph.adjacency[id].add(from);
+            union(from, id);
+        }
+    }
+
+    return edgesRemoved ? split(find(from)) : [find(from)];
+}
 
-            // Initialize group statistics
-            updateGroupStatistics(groups[groupKey], newCardinality);
-            groups[groupKey].timestamp = Date.now(); // Set the creation time of the group
+// Helper function to list the members of a recovered group that have not
+// reported since the seeding and that a report of the given motes names, or all
+// of them without motes, while the grace period lasts
+function pendingMembers(groupKey, groups, ids) {
+    const pending = [];
+    if (now >= graph.graceUntil) {
+        return pending;
+    }
+    for (const handle of groupVector(groups[groupKey])) {
+        const id = interned.slot(handle);
+        if (interned.isLive(handle) && graph.group[id] === groupKey && graph.lastReport[id] < graph.seededAt &&
+            (ids === undefined || ids.some(m => vectorHas(graph.reports[m], handle)))) {
+            pending.push(id);
+        }
+    }
+    return pending;
+}
 
-            context.set("groups", groups);
-            return groups[groupKey];
+// Function to dismantle a group whose component vanished or shrank below the minimum
+function releaseGroup(groupKey, groups) {
+    const group = groups[groupKey];
+    for (const handle of groupVector(group)) {
+        const id = interned.slot(handle);
+        if (interned.isLive(handle) && graph.group[id] === groupKey) {
+            graph.group[id] = undefined;
         }
     }
-    return null; // In case all groups are full
+    membershipChanges.push({ group: groupKey, added: [], removed: group.members.slice() });
+    lifecycleEvents.push({ type: 'dismantle', group: groupKey, generation: group.generation || 0,
+        members: group.members.slice() });
+    accumulate(group);
+    changedGroups.add(groupKey);
+    groups[groupKey] = emptyGroup(group.name, group.generation || 0);
 }
 
-// Function to process each member's group status
-function processGroupMemberships(cooja_result) {
-    const groups = context.get("groups");
-    let existingGroups = checkSenderInGroups(cooja_result);
+// Function to make a group hold exactly the members of a component
+function assignGroup(groupKey, groups, ids) {
+    let group = groups[groupKey];
+    const forming = group.members.length === 0;
+    if (forming) {
+        // A free slot becomes a new group, the creation time is now
+        group = emptyGroup(group.name, (group.generation || 0) + 1);
+        groups[groupKey] = group;
+    }
+    const vector = Uint32Array.from(ids, id => interned.handle(id)).sort();
+    const diff = diffVectors(groupVector(group), vector);
 
-    existingGroups.forEach(group => {
-        // Check if current members match the new member list
-        if (arraysEqual(group.members.sort(), cooja_result.members.sort())) {
-            // Members have not changed, update group statistics
-            updateGroupStatistics(group, group.members.length);
+    if (diff.added.length > 0 || diff.removed.length > 0) {
+        group.members = namesOf(vector);
+        vectors.set(group, vector);
+        const added = namesOf(diff.added);
+        const removed = namesOf(diff.removed);
+        membershipChanges.push({ group: groupKey, added: added, removed: removed });
+        if (forming) {
+            lifecycleEvents.push({ type: 'form', group: groupKey, generation: group.generation,
+                members: group.members.slice() });
         } else {
-            // Members have changed, process the update
-            group.members = cooja_result.members;
-            const newCardinality = group.members.length;
+            if (removed.length > 0) {
+                lifecycleEvents.push({ type: 'leave', group: groupKey, generation: group.generation,
+                    members: removed });
+            }
+            if (added.length > 0) {
+                lifecycleEvents.push({ type: 'join', group: groupKey, generation: group.generation,
+                    members: added });
+            }
+        }
+        changedGroups.add(groupKey);
+    }
+    for (const id of ids) {
+        graph.group[id] = groupKey;
+    }
+    // Statistics only move when the cardinality does
+    if (updateGroupStatistics(group, group.members.length)) {
+        changedGroups.add(groupKey);
+    }
+}
+
+// Function to map the changed components onto the group slots. A component keeps
+// the slot most of its members were in, larger components choosing first; slots
+// left without a component are dismantled. During the grace period after a
+// restart, a component claiming a recovered group keeps its members that have
+// not reported yet, and a recovered group left without a component keeps them.
+function reconcileGroups(roots) {
+    const groups = flow.get("groups");
+    const components = roots.map(root => graph.component[root])
+        .sort((a, b) => b.length - a.length);
+    const previous = new Set();
+    const claimed = new Set();
 
-            // Update statistics with new cardinality
-            updateGroupStatistics(group, newCardinality);
+    components.forEach(ids => {
+        const votes = new Map();
+        ids.forEach(id => {
+            const groupKey = graph.group[id];
+            if (groupKey !== undefined) {
+                previous.add(groupKey);
+                votes.set(groupKey, (votes.get(groupKey) || 0) + 1);
+            }
+        });
+
+        let slot = null;
+        let best = 0;
+        votes.forEach((count, groupKey) => {
+            if (!claimed.has(groupKey) && count > best) {
+                slot = groupKey;
+                best = count;
+            }
+        });
+        if (slot !== null) {
+            ids = ids.concat(pendingMembers(slot, groups, ids));
+        }
+        if (ids.length < MIN_GROUP_SIZE) {
+            ids.forEach(id => {
+                if (now >= graph.graceUntil || graph.lastReport[id] >= graph.seededAt) {
+                    graph.group[id] = undefined;
+                }
+            });
+            return;
+        }
+        if (slot === null) {
+            slot = Object.keys(groups).find(groupKey =>
+                !claimed.has(groupKey) && !previous.has(groupKey) && groups[groupKey].members.length === 0) || null;
+        }
+        if (slot === null) {
+            return; // In case all groups are full
+        }
+        claimed.add(slot);
+        assignGroup(slot, groups, ids);
+    });
+
+    previous.forEach(groupKey => {
+        if (claimed.has(groupKey) || groups[groupKey].members.length === 0) {
+            return;
+        }
+        const pending = pendingMembers(groupKey, groups);
+        if (pending.length >= MIN_GROUP_SIZE) {
+            assignGroup(groupKey, groups, pending);
+        } else {
+            releaseGroup(groupKey, groups);
         }
     });
 
-    context.set("groups", groups);
+    flow.set("groups", groups);
 }
 
-// Function to compare two arrays for equality
-function arraysEqual(arr1, arr2) {
-    if (arr1.length !== arr2.length) return false;
-    for (let i = 0; i < arr1.length; i++) {
-        if (arr1[i] !== arr2[i]) return false;
+// Function to turn a message into the new contact list of its sender
+function reportedContacts(cooja_result, sender) {
+    if (cooja_result.event === 'departure') {
+        // The mote lost a single contact, the others are still valid
+        return graph.reports[interned.slot(sender)].filter(id => id !== cooja_result.ip);
     }
-    return true;
+    // The Cooja input node hands over the interned IDs, the vector is ours to
+    // sort. An ID may have been evicted since to make room for a newer mote.
+    const contacts = cooja_result.contacts;
+    let n = 0;
+    for (let i = 0; i < contacts.length; i++) {
+        if (interned.isLive(contacts[i])) {
+            contacts[n++] = contacts[i];
+        }
+    }
+    return normalize(contacts.subarray(0, n), sender);
 }
 
-
-// Function to handle group survivability
-function survivability() {
-    const groups = context.get("groups");
-    let dismantledGroups = [];
-
+// Function to end the grace period of the recovered groups: their members still
+// silent are dropped as if they had timed out. Returns the roots of the members
+// that reported, the groups without any are dismantled.
+function endGrace() {
+    const groups = flow.get("groups");
+    const roots = [];
+    graph.graceUntil = 0;
     Object.keys(groups).forEach(groupKey => {
-        if (groups[groupKey].cardinality < 3) {
-            // Group is too small, dismantle it
-            dismantledGroups.push(groupKey);
-            groups[groupKey] = {
-                members: [],
-                cardinality: 0,
-                maximum: 0,
-                minimum: 0,
-                average: 0,
-                index: 0,
-                timestamp: Date.now(),
-                lifetime: 0,
-                dismantle_timer: Date.now()
-            };
+        const silent = [];
+        const reported = [];
+        for (const handle of groupVector(groups[groupKey])) {
+            const id = interned.slot(handle);
+            if (!interned.isLive(handle) || graph.group[id] !== groupKey) {
+                continue;
+            }
+            if (graph.lastReport[id] < graph.seededAt) {
+                silent.push(id);
+            } else {
+                reported.push(id);
+            }
+        }
+        if (silent.length === 0) {
+            return;
+        }
+        if (reported.length === 0) {
+            releaseGroup(groupKey, groups);
+        } else {
+            silent.forEach(id => { graph.group[id] = undefined; });
+            reported.forEach(id => roots.push(id));
         }
     });
+    flow.set("groups", groups);
+    return roots;
+}
+
+// Function to drop the reports of the members gone silent and evict the motes
+// idle for long, at most once per SWEEP_INTERVAL
+function sweep() {
+    if (now < graph.nextSweep) {
+        return;
+    }
+    graph.nextSweep = now + SWEEP_INTERVAL;
 
-    context.set("groups", groups);
-    return dismantledGroups;
+    let roots = [];
+    const end = interned.highWater();
+    for (let id = 0; id < end; id++) {
+        if (graph.reports[id] !== undefined && graph.reports[id].length > 0 &&
+            graph.lastReport[id] < now - MEMBER_TIMEOUT) {
+            roots = roots.concat(applyReport(interned.handle(id), new Uint32Array(0)));
+        }
+    }
+    if (graph.graceUntil !== 0 && now >= graph.graceUntil) {
+        roots = roots.concat(endGrace());
+    }
+    if (roots.length > 0) {
+        // Components may have merged back or split further since, keep the live roots
+        reconcileGroups([...new Set(roots.map(find))]);
+    }
+    evictIdle(now, false);
 }
 
 // Main execution flow
 const cooja_result = msg.payload;
-processGroupMemberships(cooja_result);
-const dismantledGroups = survivability();
-
-// Display messages for dismantled groups
-if(dismantledGroups.length > 0) {
-    dismantledGroups.forEach(groupKey => {
-        node.warn(`Group ${groupKey} has been dismantled due to insufficient members.`);
+const sender = cooja_result.sender;
+if (!interned.isLive(sender)) {
+    return null; // Evicted between the Cooja input node and here
+}
+if (!graph.seeded) {
+    // Groups recovered by the store keep their slots and members while their
+    // motes report again, for up to RECOVERY_GRACE
+    const groups = flow.get("groups");
+    Object.keys(groups).forEach(groupKey => {
+        groupVector(groups[groupKey]).forEach(id => { graph.group[interned.slot(id)] = groupKey; });
     });
+    // and are published in full, the store may have recovered them after our start
+    flow.get('groupSnapshots').publish(groups, Object.keys(groups), now);
+    // The time the store recovered by group size goes back into the sketch
+    const recoveredSizes = flow.get('recoveredSizes') || {};
+    Object.keys(recoveredSizes).forEach(size => addToSketch(Number(size), recoveredSizes[size]));
+    flow.set('recoveredSizes', undefined);
+    graph.seeded = true;
+    graph.seededAt = now;
+    graph.graceUntil = now + RECOVERY_GRACE;
+}
+// The Cooja input node calls this when the pool is full
+interned.onFull = () => evictIdle(Date.now(), true);
+
+const from = addVertex(sender);
+const reported = reportedContacts(cooja_result, sender);
+graph.lastReport[from] = now;
+graph.lastSeen[from] = now;
+for (let i = 0; i < reported.length; i++) {
+    graph.lastSeen[interned.slot(reported[i])] = now;
 }
+reconcileGroups(applyReport(sender, reported));
+sweep();
 
-// Return the updated group information
-msg.payload = context.get("groups");
+// Return the updated group information as an immutable snapshot
+msg.changed = [...changedGroups];
+msg.payload = flow.get('groupSnapshots').publish(flow.get("groups"), msg.changed, now);
+msg.membership = membershipChanges;
+msg.events = lifecycleEvents;
+msg.sizes = sizeSeconds;
+msg.fleet = {
+    p50: sketchQuantile(0.5),
+    p90: sketchQuantile(0.9),
+    p99: sketchQuantile(0.99)
+};
 return msg;
 
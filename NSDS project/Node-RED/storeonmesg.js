@@ -0,0 +1,22 @@
+// Append the groups changed by this message to the write-ahead log
+const store = context.get('store');
+const snapshot = msg.payload;
+
+// Timeline points from the history node go to its journal
+if (store && msg.archive) {
+    store.archive(msg.archive);
+    return null;
+}
+
+if (store && msg.changed && msg.changed.length > 0) {
+    store.append(msg.changed.map(key => {
+        const group = snapshot.get(key);
+        return { key: key, group: group === undefined ? null : group };
+    }));
+}
+// Time added to the size sketch, by group size
+if (store && msg.sizes && Object.keys(msg.sizes).length > 0) {
+    store.append([{ sizes: msg.sizes }]);
+}
+
+return null;
@@ -0,0 +1,282 @@
+// Crash-safe store for the group statistics and the time spent at each group
+// size (the fleet size sketch of the statistics node). Every change is
+// appended to a write-ahead log; closed log segments are folded into a compact snapshot by a
+// worker thread, so message processing never waits for a snapshot.
+const STORE_DIR = env.get('GROUP_STORE_DIR') || '/data/group-store';
+const SEGMENT_RECORDS = 50000;   // Records per log segment before it is rotated
+const COMPACT_INTERVAL = 60000;  // Milliseconds between snapshots
+const SYNC_INTERVAL = 1000;      // Milliseconds between flushes of the log to disk
+
+const SNAPSHOT_FILE = path.join(STORE_DIR, 'snapshot.json');
+// Journal of the history node, one JSON line per group and archive pass, in time order
+const ARCHIVE_FILE = path.join(STORE_DIR, 'history.log');
+const ARCHIVE_CHUNK = 65536;     // Bytes read at a time when reloading the journal
+
+function segmentFile(n) {
+    return path.join(STORE_DIR, 'wal-' + String(n).padStart(8, '0') + '.log');
+}
+
+function listSegments() {
+    return fs.readdirSync(STORE_DIR)
+        .filter(f => /^wal-\d+\.log$/.test(f))
+        .map(f => parseInt(f.slice(4, -4), 10))
+        .sort((a, b) => a - b);
+}
+
+// Function to apply the records of a log segment newer than lsn to a state,
+// returns the last applied lsn
+function replaySegment(file, state, lsn) {
+    const lines = fs.readFileSync(file, 'utf8').split('\n');
+    for (const line of lines) {
+        if (line.length === 0) {
+            continue;
+        }
+        let record;
+        try {
+            record = JSON.parse(line);
+        } catch (e) {
+            break; // Torn write at the tail of the log
+        }
+        if (record.lsn <= lsn) {
+            continue;
+        }
+        if (record.sizes) {
+            Object.keys(record.sizes).forEach(size => {
+                state.sizes[size] = (state.sizes[size] || 0) + record.sizes[size];
+            });
+        } else if (record.group === null) {
+            delete state.groups[record.key];
+        } else {
+            state.groups[record.key] = record.group;
+        }
+        lsn = record.lsn;
+    }
+    return lsn;
+}
+
+// Compaction job: snapshot + closed segments -> new snapshot, written atomically
+const WORKER_SOURCE = `
+const fs = require('fs');
+const path = require('path');
+const { workerData, parentPort } = require('worker_threads');
+${replaySegment.toString()}
+let state = { lsn: 0, groups: {}, sizes: {} };
+if (fs.existsSync(workerData.snapshot)) {
+    state = Object.assign(state, JSON.parse(fs.readFileSync(workerData.snapshot, 'utf8')));
+}
+for (const file of workerData.segments) {
+    state.lsn = replaySegment(file, state, state.lsn);
+}
+const tmp = workerData.snapshot + '.tmp';
+const fd = fs.openSync(tmp, 'w');
+fs.writeSync(fd, JSON.stringify(state));
+fs.fdatasyncSync(fd);
+fs.closeSync(fd);
+fs.renameSync(tmp, workerData.snapshot);
+const dir = fs.openSync(path.dirname(workerData.snapshot), 'r');
+fs.fsyncSync(dir);
+fs.closeSync(dir);
+for (const file of workerData.segments) {
+    fs.unlinkSync(file);
+}
+parentPort.postMessage(state.lsn);
+`;
+
+// Function to rebuild the state from the last snapshot and the log segments after it
+function recover() {
+    const started = Date.now();
+    let state = { lsn: 0, groups: {}, sizes: {} };
+
+    if (fs.existsSync(SNAPSHOT_FILE)) {
+        // Snapshots written before the sizes were persisted have none
+        state = Object.assign(state, JSON.parse(fs.readFileSync(SNAPSHOT_FILE, 'utf8')));
+    }
+    let lsn = state.lsn;
+    let lastWrite = fs.existsSync(SNAPSHOT_FILE) ? fs.statSync(SNAPSHOT_FILE).mtimeMs : 0;
+    listSegments().forEach(n => {
+        lsn = replaySegment(segmentFile(n), state, lsn);
+        lastWrite = Math.max(lastWrite, fs.statSync(segmentFile(n)).mtimeMs);
+    });
+
+    node.log(`Recovered ${Object.keys(state.groups).length} groups up to record ${lsn} in ${Date.now() - started} ms`);
+    return { groups: state.groups, sizes: state.sizes, lsn: lsn, lastWrite: lastWrite };
+}
+
+// Function to keep the downtime out of the time-weighted statistics: the open
+// segment of each group is closed where the store last wrote, the last moment
+// its cardinality is known, and the next one starts now. Returns the time
+// closed by group size, for the size sketch.
+function resume(groups, lastWrite, now) {
+    const sizes = {};
+    Object.values(groups).forEach(group => {
+        const seconds = (Math.min(lastWrite, now) - group.last_change) / 1000;
+        if (seconds > 0 && group.cardinality > 0) {
+            group.weight += seconds;
+            group.sum += group.cardinality * seconds;
+            group.sum_squares += group.cardinality * group.cardinality * seconds;
+            sizes[group.cardinality] = (sizes[group.cardinality] || 0) + seconds;
+        }
+        group.last_change = now;
+    });
+    return sizes;
+}
+
+// Function to read the journal entries of the history node with points since a
+// time. The file is read backwards from its end and only as far as needed, so a
+// long journal costs its recent part; entries are returned in time order.
+function readArchive(since) {
+    if (!fs.existsSync(ARCHIVE_FILE)) {
+        return [];
+    }
+    const entries = [];
+    const fd = fs.openSync(ARCHIVE_FILE, 'r');
+    let pos = fs.fstatSync(fd).size;
+    let rest = Buffer.alloc(0);
+    let done = false;
+
+    while (pos > 0 && !done) {
+        const n = Math.min(ARCHIVE_CHUNK, pos);
+        pos -= n;
+        const chunk = Buffer.allocUnsafe(n);
+        fs.readSync(fd, chunk, 0, n, pos);
+        const buffer = Buffer.concat([chunk, rest]);
+        let end = buffer.length;
+        for (let i = buffer.length - 1; i >= -1 && !done; i--) {
+            if (i >= 0 && buffer[i] !== 0x0a) {
+                continue;
+            }
+            if (i < 0 && pos > 0) {
+                break; // The line starts in the previous chunk
+            }
+            const line = buffer.toString('utf8', i + 1, end);
+            end = i;
+            let entry;
+            try {
+                entry = JSON.parse(line);
+            } catch (e) {
+                continue; // Empty line or torn write at the tail
+            }
+            if (entry.points[entry.points.length - 1][0] < since) {
+                done = true; // The earlier lines are older still
+            } else {
+                entries.push(entry);
+            }
+        }
+        rest = buffer.subarray(0, Math.max(end, 0));
+    }
+    fs.closeSync(fd);
+    return entries.reverse();
+}
+
+fs.mkdirSync(STORE_DIR, { recursive: true });
+const recovered = recover();
+const segments = listSegments();
+const resumedSizes = resume(recovered.groups, recovered.lastWrite, Date.now());
+
+const store = {
+    fd: null,
+    segment: segments.length > 0 ? segments[segments.length - 1] : 0,
+    records: 0,
+    lsn: recovered.lsn,
+    dirty: false,
+    syncFd: null,
+    compacting: false
+};
+
+// Always start a fresh segment, the last one may end with a torn record
+function openSegment(n) {
+    store.segment = n;
+    store.fd = fs.openSync(segmentFile(n), 'a');
+    store.records = 0;
+}
+
+store.rotate = function () {
+    const old = store.fd;
+    openSegment(store.segment + 1);
+    if (store.syncFd !== old) {
+        fs.closeSync(old); // Otherwise closed once its pending flush completes
+    }
+};
+
+store.append = function (changes) {
+    let lines = '';
+    changes.forEach(change => {
+        store.lsn += 1;
+        lines += JSON.stringify(Object.assign({ lsn: store.lsn }, change)) + '\n';
+    });
+    fs.writeSync(store.fd, lines);
+    store.records += changes.length;
+    store.dirty = true;
+    if (store.records >= SEGMENT_RECORDS) {
+        store.compact();
+    }
+};
+
+store.archive = function (archived) {
+    fs.appendFileSync(ARCHIVE_FILE, archived.map(entry => JSON.stringify(entry) + '\n').join(''));
+};
+
+store.sync = function () {
+    if (!store.dirty || store.syncFd !== null) {
+        return;
+    }
+    const fd = store.fd;
+    store.dirty = false;
+    store.syncFd = fd;
+    fs.fdatasync(fd, () => {
+        store.syncFd = null;
+        if (fd !== store.fd) {
+            fs.close(fd, () => {});
+        }
+    });
+};
+
+store.compact = function () {
+    if (store.compacting || (store.records === 0 && listSegments().length <= 1)) {
+        return;
+    }
+    store.rotate();
+    const closed = listSegments().filter(n => n < store.segment).map(segmentFile);
+
+    store.compacting = true;
+    const worker = new worker_threads.Worker(WORKER_SOURCE, {
+        eval: true,
+        workerData: { snapshot: SNAPSHOT_FILE, segments: closed }
+    });
+    worker.once('message', lsn => node.log(`Snapshot written up to record ${lsn}`));
+    worker.once('error', err => node.error(`Snapshot failed: ${err.message}`));
+    worker.once('exit', () => {
+        store.compacting = false;
+    });
+};
+
+openSegment(store.segment + 1);
+// The resumed groups are logged again: their segments are closed up to now,
+// and the new segment moves the last write past the downtime
+store.append(Object.keys(recovered.groups).map(key => ({ key: key, group: recovered.groups[key] })));
+if (Object.keys(resumedSizes).length > 0) {
+    store.append([{ sizes: resumedSizes }]);
+}
+store.syncTimer = setInterval(store.sync, SYNC_INTERVAL);
+store.compactTimer = setInterval(store.compact, COMPACT_INTERVAL);
+context.set('store', store);
+
+// The history node replays its journal with its first message
+flow.set('historyArchive', {
+    read: readArchive,
+    lastWrite: fs.existsSync(ARCHIVE_FILE) ? fs.statSync(ARCHIVE_FILE).mtimeMs : 0
+});
+// Hand the recovered groups and sizes to the statistical computation, which
+// adds the sizes to its sketch with its first message
+Object.keys(resumedSizes).forEach(size => {
+    recovered.sizes[size] = (recovered.sizes[size] || 0) + resumedSizes[size];
+});
+flow.set('recoveredSizes', recovered.sizes);
+let groups = flow.get('groups') || {};
+Object.assign(groups, recovered.groups);
+flow.set('groups', groups);
+// and publish them to the readers if its snapshots are already set up
+const snapshots = flow.get('groupSnapshots');
+if (snapshots) {
+    snapshots.publish(groups, Object.keys(recovered.groups), Date.now());
+}
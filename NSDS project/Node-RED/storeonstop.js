@@ -0,0 +1,10 @@
+// Flush and close the write-ahead log
+const store = context.get('store');
+
+if (store) {
+    clearInterval(store.syncTimer);
+    clearInterval(store.compactTimer);
+    fs.fdatasyncSync(store.fd);
+    fs.closeSync(store.fd);
+    context.set('store', undefined);
+}
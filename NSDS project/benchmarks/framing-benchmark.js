@@ -0,0 +1,308 @@
+/*
+ * Serial framing benchmark of the UDP uplink bridge, run with node:
+ *
+ *   node framing-benchmark.js [--motes 60] [--period 30] [--churn 0.02]
+ *                             [--baud 115200] [--seconds 600] [--seed 1]
+ *
+ * Compares how many events per second the serial line between the border
+ * router and the host carries with the two framings of the bridge (make
+ * UPLINK=udp FRAMING=mqtt|compressed in rpl-border-router):
+ *
+ *   mqtt        every event is an MQTT PUBLISH with QoS 1 over TCP/IPv6,
+ *               SLIP-encoded by tunslip6, and the bridge waits for the PUBACK
+ *               segment coming back on the line before the next publish
+ *   compressed  every event is a frame of common/uplink-framing.h, encoded as
+ *               uplink-framing.c does and written without waiting
+ *
+ * The line is a fixed-baud stand-in (8N1, 10 bits a byte) kept busy for
+ * --seconds: the events are rounds of reports of --motes motes in groups of
+ * four, each mote reporting its group with its seq moving on, and before every
+ * round a --churn share of the motes moves to another group, which changes the
+ * reports and has the old mates report a departure. --period only turns the
+ * events per second into the number of motes reporting that often the line
+ * keeps up with. The compressed stream goes through the SLIP splitter and
+ * frame decoder of ../rpl-border-router/host-bridge.js in random chunks, and
+ * every rebuilt event must match the original.
+ */
+const path = require('path');
+
+const bridge = require(path.join(__dirname, '..', 'rpl-border-router', 'host-bridge.js'));
+
+const TOPIC_PREFIX = 'nsds_gm/contacts/';
+const GROUP_SIZE = 4;
+// Topic ids are a byte and the border router tracks BRIDGE_MAX_SENDERS motes
+const MAX_MOTES = 64;
+// FRAMING_EPOCH_PERIOD of the border router, in seconds
+const EPOCH_PERIOD = 60;
+
+// Header sizes of the MQTT framing: uncompressed IPv6 and TCP without options
+// as tunslip6 carries them, PUBLISH fixed header and packet id, PUBACK
+const IPV6_HEADER = 40;
+const TCP_HEADER = 20;
+const PUBACK = 4;
+
+// common/uplink-framing.h
+const FRAME_MARKER = 0x23;
+const FRAME_REPORT = 0;
+const FRAME_REPEAT = 1;
+const FRAME_RAW = 2;
+const FRAME_DEFINE = 0x80;
+const FRAME_NEXT_SEQ = 0x40;
+const FRAME_SUFFIX_MAX = 40;
+const SEQ_PREFIX = Buffer.from('{"seq": ');
+
+// Same as split_seq() of uplink-framing.c
+function splitSeq(payload) {
+    let i = SEQ_PREFIX.length;
+    let value = 0;
+    const digit = (c) => c >= 0x30 && c <= 0x39;
+
+    if (payload.length < i || !payload.subarray(0, i).equals(SEQ_PREFIX)) {
+        return null;
+    }
+    if (i < payload.length && payload[i] === 0x30 && i + 1 < payload.length && payload[i + 1] !== 0x2c) {
+        return null;
+    }
+    for (; i < payload.length && digit(payload[i]) && value <= 0xffff; i++) {
+        value = value * 10 + payload[i] - 0x30;
+    }
+    if (value > 0xffff || i === SEQ_PREFIX.length || i + 2 > payload.length || payload[i] !== 0x2c ||
+        payload[i + 1] !== 0x20) {
+        return null;
+    }
+    return { seq: value, prefix: i + 2 };
+}
+
+// Same as uplink_framing_encode() of uplink-framing.c
+function encodeFrame(topic, id, epoch, suffix, payload) {
+    const out = [FRAME_MARKER, 0, id];
+    let flags = 0;
+
+    if (topic.epoch !== epoch) {
+        const name = Buffer.from(suffix, 'latin1').subarray(0, FRAME_SUFFIX_MAX);
+        out.push(name.length, ...name);
+        topic.epoch = epoch;
+        topic.bodyLen = 0;
+        flags |= FRAME_DEFINE;
+    }
+
+    const split = splitSeq(payload);
+    const body = split ? payload.subarray(split.prefix) : null;
+    if (split === null || body.length === 0 || body.length > 0xff) {
+        out[1] = flags | FRAME_RAW;
+        return Buffer.concat([Buffer.from(out), payload]);
+    }
+
+    if (topic.bodyLen !== 0 && split.seq === ((topic.seq + 1) & 0xffff)) {
+        flags |= FRAME_NEXT_SEQ;
+    } else {
+        out.push(split.seq >> 8, split.seq & 0xff);
+    }
+    topic.seq = split.seq;
+
+    const hash = bridge.fnv1a(body);
+    out.push(bridge.frameCheck(hash, split.seq));
+    if (topic.bodyLen === body.length && topic.bodyHash === hash) {
+        out[1] = flags | FRAME_REPEAT;
+        return Buffer.from(out);
+    }
+    out[1] = flags | FRAME_REPORT;
+    topic.bodyHash = hash;
+    topic.bodyLen = body.length;
+    return Buffer.concat([Buffer.from(out), body]);
+}
+
+function newTopic() {
+    return { bodyHash: 0, seq: 0, bodyLen: 0, epoch: 0 };
+}
+
+// Bytes of a SLIP frame with its END, escapes included
+function slipLength(length, escaped) {
+    return length + escaped + 1;
+}
+
+function countEscaped(buffer) {
+    let n = 0;
+    for (let i = 0; i < buffer.length; i++) {
+        n += buffer[i] === 0xc0 || buffer[i] === 0xdb;
+    }
+    return n;
+}
+
+function remainingLength(length) {
+    return length < 128 ? 1 : length < 16384 ? 2 : 3;
+}
+
+// Line bytes of an event with the MQTT framing, both ways since the bridge has
+// one publish in flight
+function mqttEventBytes(topic, payload) {
+    const body = 2 + Buffer.byteLength(topic) + 2 + payload.length;
+    const publish = IPV6_HEADER + TCP_HEADER + 1 + remainingLength(body) + body;
+    const puback = IPV6_HEADER + TCP_HEADER + PUBACK;
+    // Headers are taken as free of escaped bytes, the payload is counted
+    return slipLength(publish, countEscaped(payload)) + slipLength(puback, 0);
+}
+
+function address(mote) {
+    return 'fd00::212:74' + ((mote >> 16) & 0xff).toString(16).padStart(2, '0') + ':' +
+           ((mote >> 8) & 0xff).toString(16) + ':' + (mote & 0xff).toString(16);
+}
+
+// Deterministic generator, so both framings see the same events
+function random(seed) {
+    let state = seed >>> 0 || 1;
+    return function () {
+        state ^= state << 13;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        return (state >>> 0) / 4294967296;
+    };
+}
+
+// Events of the fleet, in the order the border router bridges them
+function* workload(options, rand) {
+    const motes = [];
+    for (let m = 0; m < options.motes; m++) {
+        motes.push({ name: address(m + 1).slice(6), group: Math.floor(m / GROUP_SIZE),
+                     seq: Math.floor(rand() * 0x10000) });
+    }
+    const groups = Math.ceil(options.motes / GROUP_SIZE);
+    const event = (mote, text) => {
+        const payload = Buffer.from('{"seq": ' + mote.seq + ', ' + text + '}');
+        mote.seq = (mote.seq + 1) & 0xffff;
+        return { mote: mote, payload: payload };
+    };
+
+    while (true) {
+        for (let k = Math.round(options.churn * motes.length); k > 0; k--) {
+            const mote = motes[Math.floor(rand() * motes.length)];
+            for (const mate of motes) {
+                if (mate !== mote && mate.group === mote.group) {
+                    yield event(mate, '"event": "departure", "ip": "' + mote.name + '"');
+                }
+            }
+            mote.group = Math.floor(rand() * groups);
+        }
+        for (const mote of motes) {
+            const mates = motes.filter((m) => m !== mote && m.group === mote.group).map((m) => '"' + m.name + '"');
+            if (mates.length > 0) {
+                yield event(mote, '"group": true, "members": [' + mates.join(',') + ']');
+            }
+        }
+    }
+}
+
+function run(options) {
+    const lineRate = options.baud / 10;
+    const rand = random(options.seed);
+    const events = workload(options, rand);
+    const topics = new Map();
+    const decoder = new bridge.FrameDecoder();
+    const expected = [];
+    let mismatches = 0;
+    const splitter = new bridge.SlipSplitter(function (raw) {
+        const event = decoder.decode(bridge.slipDecode(raw));
+        const original = expected.shift();
+        if (!event || event.topic !== original.topic || !event.payload.equals(original.payload)) {
+            mismatches++;
+        }
+    });
+    const mqtt = { events: 0, bytes: 0, payload: 0 };
+    const compressed = { events: 0, bytes: 0, payload: 0 };
+    const kinds = { define: 0, report: 0, repeat: 0, raw: 0, nextSeq: 0 };
+    let pending = [];
+
+    // Both framings run on the same events until their line time is used up
+    while (mqtt.bytes < options.seconds * lineRate || compressed.bytes < options.seconds * lineRate) {
+        const e = events.next().value;
+        const topic = TOPIC_PREFIX + e.mote.name;
+
+        if (mqtt.bytes < options.seconds * lineRate) {
+            mqtt.bytes += mqttEventBytes(topic, e.payload);
+            mqtt.payload += e.payload.length;
+            mqtt.events++;
+        }
+        if (compressed.bytes < options.seconds * lineRate) {
+            let state = topics.get(e.mote);
+            if (state === undefined) {
+                state = { id: topics.size, framing: newTopic() };
+                topics.set(e.mote, state);
+            }
+            const epoch = Math.floor(compressed.bytes / lineRate / EPOCH_PERIOD) % 255 + 1;
+            const frame = encodeFrame(state.framing, state.id, epoch, e.mote.name, e.payload);
+            const raw = bridge.slipEncode(frame);
+
+            kinds.define += (frame[1] & FRAME_DEFINE) !== 0;
+            kinds.nextSeq += (frame[1] & FRAME_NEXT_SEQ) !== 0;
+            kinds[['report', 'repeat', 'raw'][frame[1] & 0x0f]]++;
+            expected.push({ topic: topic, payload: e.payload });
+            pending.push(raw);
+            compressed.bytes += raw.length;
+            compressed.payload += e.payload.length;
+            compressed.events++;
+
+            // The host reads the line in chunks that split frames anywhere
+            if (pending.length >= 8) {
+                const stream = Buffer.concat(pending);
+                pending = [];
+                for (let i = 0; i < stream.length;) {
+                    const n = 1 + Math.floor(rand() * 64);
+                    splitter.push(stream.subarray(i, i + n));
+                    i += n;
+                }
+            }
+        }
+    }
+    splitter.push(Buffer.concat(pending));
+
+    return { mqtt: mqtt, compressed: compressed, kinds: kinds, decoder: decoder,
+             mismatches: mismatches + expected.length };
+}
+
+function main() {
+    const options = { motes: 60, period: 30, churn: 0.02, baud: 115200, seconds: 600, seed: 1 };
+    for (let i = 2; i < process.argv.length; i += 2) {
+        const key = process.argv[i].replace(/^--/, '');
+        if (!(key in options)) {
+            console.error('usage: node framing-benchmark.js [--motes n] [--period s] [--churn share] ' +
+                          '[--baud n] [--seconds s] [--seed n]');
+            process.exit(1);
+        }
+        options[key] = Number(process.argv[i + 1]);
+    }
+    if (options.motes < GROUP_SIZE || options.motes > MAX_MOTES) {
+        console.error('--motes must be between ' + GROUP_SIZE + ' and ' + MAX_MOTES);
+        process.exit(1);
+    }
+
+    const r = run(options);
+    const line = (name, s) => {
+        const eps = s.events / options.seconds;
+        console.log(name.padEnd(12) + eps.toFixed(1).padStart(10) + (s.bytes / s.events).toFixed(1).padStart(12) +
+                    (s.payload / s.events).toFixed(1).padStart(13) + (100 * s.bytes / (options.seconds *
+                    options.baud / 10)).toFixed(0).padStart(8));
+    };
+
+    console.log('Line ' + options.baud + ' baud for ' + options.seconds + ' s, ' + options.motes + ' motes, churn ' +
+                options.churn + ' per round');
+    console.log('framing     events/s  line B/event  payload B/event  busy %');
+    line('mqtt', r.mqtt);
+    line('compressed', r.compressed);
+    console.log('Compression ' + (r.mqtt.bytes / r.mqtt.events / (r.compressed.bytes / r.compressed.events)).toFixed(1) +
+                'x, throughput ' + (r.compressed.events / r.mqtt.events).toFixed(1) + 'x');
+    console.log('Frames: ' + r.kinds.report + ' reports, ' + r.kinds.repeat + ' repeats, ' + r.kinds.raw + ' raw, ' +
+                r.kinds.define + ' with a definition, ' + r.kinds.nextSeq + ' with the seq left out');
+    // A mote needs its events bridged within its reporting period
+    console.log('Motes the line keeps up with at one report each ' + options.period + ' s: mqtt ' +
+                Math.floor(r.mqtt.events / options.seconds * options.period) + ', compressed ' +
+                Math.floor(r.compressed.events / options.seconds * options.period));
+    console.log('Decoded ' + r.decoder.events + ' events, unknown topic ' + r.decoder.unknown + ', check mismatch ' +
+                r.decoder.mismatch + ', wrong events ' + r.mismatches + ': ' + (r.mismatches === 0 ? 'OK' : 'FAILED'));
+    process.exit(r.mismatches === 0 ? 0 : 1);
+}
+
+module.exports = { encodeFrame: encodeFrame, newTopic: newTopic };
+
+if (require.main === module) {
+    main();
+}
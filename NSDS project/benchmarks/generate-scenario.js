@@ -0,0 +1,361 @@
+/*
+ * Cooja scenario generator for simulated crowds, run with node:
+ *
+ *   node generate-scenario.js --motes 500 [options] --out crowd-500.csc
+ *
+ *   --motes N          motes including the border router (default 100)
+ *   --signalers F      fraction of udp-signaler motes, the rest run mqtt-udp-mote (default 0.1)
+ *   --density D        motes per hectare (default 10, about 11 neighbours in range)
+ *   --layout L         grid or random (default grid)
+ *   --root R           border router at center, corner, edge or X,Y in metres (default center)
+ *   --range M          UDGM transmission and interference range in metres (default 60)
+ *   --mobile F         fraction of motes moving by random waypoint (default 0)
+ *   --speed V          walking speed in m/s (default 1.4)
+ *   --pause S          pause at each waypoint in seconds (default 30)
+ *   --duration S       length of the mobility trace in seconds (default 1800)
+ *   --step S           sampling period of the trace in seconds (default 2)
+ *   --uplink U         mqtt or udp (default udp)
+ *   --mac M            csma or tsch (default csma)
+ *   --power P          on or low, the power-managed mode on TSCH (default on)
+ *   --profile P        contact engine profile: tiny, standard or dense (default standard)
+ *   --contacts C       contact evidence: beacon or link (default beacon)
+ *   --script FILE      ScriptRunner script next to this generator (default uplink-benchmark.js)
+ *   --seed S           random seed of the layout, the mote types and the trace (default 1)
+ *
+ * The mote types keep the identifiers of GroupMonitoringProject.csc (mtype145
+ * border router, mtype56 mqtt-udp-mote, mtype38 udp-signaler). The border
+ * router is always mote 1, the first in the file. With --mobile the trace is
+ * written next to the scenario as <name>.dat for the Cooja mobility plugin.
+ * The connectivity of the crowd (neighbours in range, motes cut off from the
+ * border router, isolated mobile motes along the trace) is printed at the end.
+ */
+const fs = require('fs');
+const path = require('path');
+const NeighbourGrid = require('./neighbour-grid');
+
+const DEFAULTS = {
+    motes: 100, signalers: 0.1, density: 10, layout: 'grid', root: 'center', range: 60,
+    mobile: 0, speed: 1.4, pause: 30, duration: 1800, step: 2,
+    uplink: 'udp', mac: 'csma', power: 'on', profile: 'standard', contacts: 'beacon',
+    script: 'uplink-benchmark.js', seed: 1, out: null
+};
+
+const INTERFACES = [
+    'org.contikios.cooja.interfaces.Position',
+    'org.contikios.cooja.interfaces.Battery',
+    'org.contikios.cooja.contikimote.interfaces.ContikiVib',
+    'org.contikios.cooja.contikimote.interfaces.ContikiMoteID',
+    'org.contikios.cooja.contikimote.interfaces.ContikiRS232',
+    'org.contikios.cooja.contikimote.interfaces.ContikiBeeper',
+    'org.contikios.cooja.interfaces.RimeAddress',
+    'org.contikios.cooja.contikimote.interfaces.ContikiIPAddress',
+    'org.contikios.cooja.contikimote.interfaces.ContikiRadio',
+    'org.contikios.cooja.contikimote.interfaces.ContikiButton',
+    'org.contikios.cooja.contikimote.interfaces.ContikiPIR',
+    'org.contikios.cooja.contikimote.interfaces.ContikiClock',
+    'org.contikios.cooja.contikimote.interfaces.ContikiLED',
+    'org.contikios.cooja.contikimote.interfaces.ContikiCFS',
+    'org.contikios.cooja.contikimote.interfaces.ContikiEEPROM',
+    'org.contikios.cooja.interfaces.Mote2MoteRelations',
+    'org.contikios.cooja.interfaces.MoteAttributes'
+];
+
+const TYPES = {
+    root: { id: 'mtype145', description: 'rpl-border-router', source: 'rpl-border-router/rpl-router.c', project: 'rpl-router' },
+    mote: { id: 'mtype56', description: 'mqtt mote', source: 'mqtt-mote/mqtt-udp-mote.c', project: 'mqtt-udp-mote' },
+    signaler: { id: 'mtype38', description: 'udp-signaler', source: 'udp-signaler/udp-signaler.c', project: 'udp-signaler' }
+};
+
+function parseArgs(argv) {
+    const options = Object.assign({}, DEFAULTS);
+    for (let i = 0; i < argv.length; i += 2) {
+        const key = argv[i].replace(/^--/, '');
+        if (!(key in DEFAULTS) || i + 1 >= argv.length) {
+            throw new Error('Unknown or incomplete option ' + argv[i]);
+        }
+        options[key] = typeof DEFAULTS[key] === 'number' ? parseFloat(argv[i + 1]) : argv[i + 1];
+    }
+    if (!options.out) {
+        options.out = 'crowd-' + options.motes + '.csc';
+    }
+    // The power-managed mode duty-cycles the radio with TSCH
+    if (options.power === 'low') {
+        options.mac = 'tsch';
+    }
+    return options;
+}
+
+// Small seeded generator (mulberry32), so that a scenario can be rebuilt exactly
+function random(seed) {
+    let a = seed >>> 0;
+    return function () {
+        a = (a + 0x6d2b79f5) >>> 0;
+        let t = a;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+// Places the motes other than the border router on a square of the requested density
+function layout(options, rand) {
+    const count = options.motes - 1;
+    const side = Math.sqrt(count * 10000 / options.density);
+    const positions = [];
+
+    if (options.layout === 'random') {
+        for (let i = 0; i < count; i++) {
+            positions.push([rand() * side, rand() * side]);
+        }
+    } else {
+        const columns = Math.ceil(Math.sqrt(count));
+        const spacing = side / columns;
+        if (spacing > options.range) {
+            console.warn('Grid spacing ' + spacing.toFixed(1) + ' m exceeds the radio range, the crowd is disconnected');
+        }
+        for (let i = 0; i < count; i++) {
+            positions.push([(i % columns) * spacing, Math.floor(i / columns) * spacing]);
+        }
+    }
+    return { side: side, positions: positions };
+}
+
+function rootPosition(options, side) {
+    switch (options.root) {
+    case 'center':
+        return [side / 2, side / 2];
+    case 'corner':
+        return [-options.range / 2, -options.range / 2];
+    case 'edge':
+        return [side / 2, -options.range / 2];
+    default: {
+        const xy = options.root.split(',').map(parseFloat);
+        if (xy.length !== 2 || xy.some(isNaN)) {
+            throw new Error('--root expects center, corner, edge or X,Y');
+        }
+        return xy;
+    }
+    }
+}
+
+// Neighbour index of the motes at their initial positions
+function placeOnGrid(options, motes) {
+    const grid = new NeighbourGrid(options.range);
+    motes.forEach(function (mote, index) {
+        grid.move(index, mote.position[0], mote.position[1]);
+    });
+    return grid;
+}
+
+// Random waypoint trace in the format of the Cooja mobility plugin: mote index,
+// time, x, y, in time order. The mobile motes move on the neighbour grid, which
+// counts the samples where one had nobody in range.
+function mobilityTrace(options, motes, side, rand, grid) {
+    const lines = ['# Random waypoint: ' + options.speed + ' m/s, ' + options.pause + ' s pauses'];
+    const travel = options.speed * options.step;
+    const walkers = [];
+    let samples = 0;
+    let isolated = 0;
+
+    motes.forEach(function (mote, index) {
+        if (mote.mobile) {
+            walkers.push({
+                index: index, x: mote.position[0], y: mote.position[1],
+                pauseUntil: rand() * options.pause, target: [rand() * side, rand() * side]
+            });
+        }
+    });
+
+    for (let t = 0; t <= options.duration; t += options.step) {
+        walkers.forEach(function (w) {
+            if (t >= w.pauseUntil) {
+                const dx = w.target[0] - w.x;
+                const dy = w.target[1] - w.y;
+                const distance = Math.sqrt(dx * dx + dy * dy);
+                if (distance <= travel) {
+                    w.x = w.target[0];
+                    w.y = w.target[1];
+                    w.target = [rand() * side, rand() * side];
+                    w.pauseUntil = t + options.pause;
+                } else {
+                    w.x += dx / distance * travel;
+                    w.y += dy / distance * travel;
+                }
+            }
+            grid.move(w.index, w.x, w.y);
+            lines.push(w.index + ' ' + t.toFixed(1) + ' ' + w.x.toFixed(2) + ' ' + w.y.toFixed(2));
+        });
+        walkers.forEach(function (w) {
+            samples++;
+            isolated += grid.degree(w.index, options.range) === 0;
+        });
+    }
+    return { text: lines.join('\n') + '\n', samples: samples, isolated: isolated };
+}
+
+function connectivity(options, motes, grid) {
+    let neighbours = 0;
+    let isolated = 0;
+    motes.forEach(function (mote, index) {
+        const degree = grid.degree(index, options.range);
+        neighbours += degree;
+        isolated += degree === 0;
+    });
+    return {
+        neighbours: neighbours / motes.length,
+        isolated: isolated,
+        // The border router is mote index 0
+        reachRoot: grid.reachable(0, options.range) - 1
+    };
+}
+
+function moteType(type, options, toProject) {
+    const make = 'make ' + type.project + '.cooja TARGET=cooja UPLINK=' + options.uplink + ' MAC=' + options.mac +
+                 ' POWER=' + options.power + ' PROFILE=' + options.profile + ' CONTACTS=' + options.contacts + ' BENCHMARK=1';
+    return [
+        '    <motetype>',
+        '      org.contikios.cooja.contikimote.ContikiMoteType',
+        '      <identifier>' + type.id + '</identifier>',
+        '      <description>' + type.description + '</description>',
+        '      <source>[CONFIG_DIR]/' + toProject + type.source + '</source>',
+        '      <commands>make clean TARGET=cooja&#xD;',
+        make + '</commands>'
+    ].concat(INTERFACES.map((i) => '      <moteinterface>' + i + '</moteinterface>'), [
+        '      <symbols>false</symbols>',
+        '    </motetype>'
+    ]);
+}
+
+function mote(m) {
+    return [
+        '    <mote>',
+        '      <interface_config>',
+        '        org.contikios.cooja.interfaces.Position',
+        '        <x>' + m.position[0].toFixed(1) + '</x>',
+        '        <y>' + m.position[1].toFixed(1) + '</y>',
+        '        <z>0.0</z>',
+        '      </interface_config>',
+        '      <interface_config>',
+        '        org.contikios.cooja.contikimote.interfaces.ContikiMoteID',
+        '        <id>' + m.id + '</id>',
+        '      </interface_config>',
+        '      <motetype_identifier>' + m.type.id + '</motetype_identifier>',
+        '    </mote>'
+    ];
+}
+
+function plugin(name, config, z) {
+    return ['  <plugin>', '    ' + name].concat(config, [
+        '    <width>600</width>',
+        '    <z>' + z + '</z>',
+        '    <height>400</height>',
+        '    <location_x>' + (z * 600) + '</location_x>',
+        '    <location_y>0</location_y>',
+        '  </plugin>'
+    ]);
+}
+
+function generate(options) {
+    const rand = random(options.seed);
+    const out = path.resolve(options.out);
+    const outDir = path.dirname(out);
+    // Paths in the scenario are relative to its folder ([CONFIG_DIR])
+    const toProject = path.relative(outDir, path.join(__dirname, '..')).split(path.sep).join('/');
+    const toBenchmarks = path.relative(outDir, __dirname).split(path.sep).join('/');
+    const prefix = (p) => (p ? p + '/' : '');
+
+    const placed = layout(options, rand);
+    const motes = [{ id: 1, type: TYPES.root, position: rootPosition(options, placed.side), mobile: false }];
+    placed.positions.forEach(function (position, i) {
+        motes.push({
+            id: i + 2,
+            type: rand() < options.signalers ? TYPES.signaler : TYPES.mote,
+            position: position,
+            mobile: rand() < options.mobile
+        });
+    });
+
+    const grid = placeOnGrid(options, motes);
+    const links = connectivity(options, motes, grid);
+
+    const title = 'Crowd of ' + options.motes + ' motes (' + options.layout + ', ' + options.density + '/ha, ' +
+                  options.mac.toUpperCase() + ', ' + options.uplink + ' uplink)';
+    const projects = ['mrm', 'mspsim', 'avrora', 'serial_socket', 'powertracker'];
+    if (options.mobile > 0) {
+        projects.push('mobility');
+    }
+
+    let lines = ['<?xml version="1.0" encoding="UTF-8"?>', '<simconf>']
+        .concat(projects.map((p) => '  <project EXPORT="discard">[APPS_DIR]/' + p + '</project>'), [
+            '  <simulation>',
+            '    <title>' + title + '</title>',
+            '    <speedlimit>10.0</speedlimit>',
+            '    <randomseed>' + (123456 + options.seed) + '</randomseed>',
+            '    <motedelay_us>1000000</motedelay_us>',
+            '    <radiomedium>',
+            '      org.contikios.cooja.radiomediums.UDGM',
+            '      <transmitting_range>' + options.range.toFixed(1) + '</transmitting_range>',
+            '      <interference_range>' + options.range.toFixed(1) + '</interference_range>',
+            '      <success_ratio_tx>1.0</success_ratio_tx>',
+            '      <success_ratio_rx>1.0</success_ratio_rx>',
+            '    </radiomedium>',
+            '    <events>',
+            '      <logoutput>40000</logoutput>',
+            '    </events>'
+        ]);
+    [TYPES.root, TYPES.mote, TYPES.signaler].forEach(function (type) {
+        Array.prototype.push.apply(lines, moteType(type, options, prefix(toProject)));
+    });
+    motes.forEach(function (m) {
+        Array.prototype.push.apply(lines, mote(m));
+    });
+    lines.push('  </simulation>');
+
+    let z = 0;
+    if (options.script) {
+        lines = lines.concat(plugin('org.contikios.cooja.plugins.ScriptRunner', [
+            '    <plugin_config>',
+            '      <scriptfile>[CONFIG_DIR]/' + prefix(toBenchmarks) + options.script + '</scriptfile>',
+            '      <active>true</active>',
+            '    </plugin_config>'
+        ], z++));
+    }
+    lines = lines.concat(plugin('org.contikios.cooja.serialsocket.SerialSocketServer', [
+        '    <mote_arg>0</mote_arg>',
+        '    <plugin_config>',
+        '      <port>60001</port>',
+        '      <bound>true</bound>',
+        '    </plugin_config>'
+    ], z++));
+    let walk = null;
+    if (options.mobile > 0) {
+        const trace = out.replace(/\.csc$/, '') + '.dat';
+        walk = mobilityTrace(options, motes, placed.side, rand, grid);
+        fs.writeFileSync(trace, walk.text);
+        lines = lines.concat(plugin('Mobility', [
+            '    <plugin_config>',
+            '      <positions EXPORT="copy">[CONFIG_DIR]/' + path.basename(trace) + '</positions>',
+            '    </plugin_config>'
+        ], z++));
+    }
+    lines.push('</simconf>', '');
+
+    fs.writeFileSync(out, lines.join('\n'));
+    const signalers = motes.filter((m) => m.type === TYPES.signaler).length;
+    const mobile = motes.filter((m) => m.mobile).length;
+    console.log(path.basename(out) + ': ' + motes.length + ' motes (' + signalers + ' signalers, ' + mobile +
+                ' mobile) on ' + placed.side.toFixed(0) + ' m x ' + placed.side.toFixed(0) + ' m');
+    console.log('Connectivity: ' + links.neighbours.toFixed(1) + ' neighbours in range on average, ' + links.isolated +
+                ' isolated, ' + links.reachRoot + ' of ' + (motes.length - 1) + ' motes reach the border router');
+    if (walk) {
+        console.log('Mobility: mobile motes alone in ' + (walk.samples ? 100 * walk.isolated / walk.samples : 0).toFixed(1) +
+                    '% of the trace samples');
+    }
+}
+
+try {
+    generate(parseArgs(process.argv.slice(2)));
+} catch (err) {
+    console.error(err.message);
+    process.exit(1);
+}
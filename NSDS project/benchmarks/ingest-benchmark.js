@@ -0,0 +1,97 @@
+/*
+ * Ingest benchmark of the Node-RED backend, run with node:
+ *
+ *   node ingest-benchmark.js [messages] [motes]
+ *
+ * The function nodes are loaded from ../Node-RED the way Node-RED wraps them.
+ * MQTT messages are prepared as raw receive buffers, as delivered by the
+ * "mqtt in" node, and fed to the Cooja input node alone (ingest) and then to
+ * the Cooja input and statistics nodes in sequence (full path). The "json" line
+ * is the previous ingest for reference: JSON.parse by the "mqtt in" node, topic
+ * split and a string-keyed Map lookup per address.
+ */
+const fs = require('fs');
+const path = require('path');
+
+const MESSAGES = parseInt(process.argv[2] || '2000000', 10);
+const MOTES = parseInt(process.argv[3] || '1000', 10);
+const CONTACTS = 5;
+const NODE_RED = path.join(__dirname, '..', 'Node-RED');
+
+// Minimal function-node sandbox: shared flow context, per-node context
+const flowStore = new Map();
+const flow = { get: (k) => flowStore.get(k), set: (k, v) => flowStore.set(k, v) };
+const quiet = { warn: () => {}, log: () => {}, error: () => {} };
+
+function load(file, initialize) {
+    const store = new Map();
+    const context = { get: (k) => store.get(k), set: (k, v) => store.set(k, v) };
+    const env = { get: () => undefined };
+    const source = (name) => fs.readFileSync(path.join(NODE_RED, name), 'utf8');
+
+    new Function('node', 'context', 'flow', 'env', source(initialize))(quiet, context, flow, env);
+    const fn = new Function('msg', 'node', 'context', 'flow', 'env', source(file));
+    return (msg) => fn(msg, quiet, context, flow, env);
+}
+
+function address(mote) {
+    return 'fd00::212:74' + (mote >> 8).toString(16).padStart(2, '0') + ':' + (mote & 0xff).toString(16) + ':' + mote.toString(16);
+}
+
+// Every mote reports its neighbours on a ring, departures are one in ten. The
+// ring shifts by one every other round, so that no report repeats the sender's
+// previous message and passes for a QoS 1 redelivery.
+const messages = [];
+for (let round = 0; round < 2; round++) {
+    for (let m = 0; m < MOTES; m++) {
+        const contacts = [];
+        for (let k = 1 + round; k <= CONTACTS + round; k++) {
+            contacts.push('"' + address((m + k) % MOTES) + '"');
+        }
+        // Topics arrive as flat strings decoded from the packet
+        messages.push({ topic: Buffer.from('nsds_gm/contacts/' + address(m)).toString(),
+            payload: Buffer.from('{"group": true, "members": [' + contacts.join(',') + ']}') });
+        if (m % 10 === 0) {
+            messages.push({ topic: messages[messages.length - 1].topic,
+                payload: Buffer.from('{"event": "departure", "ip": "' + address((m + 1) % MOTES) + '"}') });
+        }
+    }
+}
+
+function measure(label, step) {
+    // Warm up, then time
+    for (let i = 0; i < 10000; i++) {
+        step(messages[i % messages.length]);
+    }
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < MESSAGES; i++) {
+        step(messages[i % messages.length]);
+    }
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    console.log(label.padEnd(10) + (MESSAGES / seconds / 1e6).toFixed(2) + ' M msg/s  (' +
+        (seconds * 1e9 / MESSAGES).toFixed(0) + ' ns/msg, ' + MESSAGES + ' messages, ' + MOTES + ' motes)');
+}
+
+const stats = load('statonmesg.js', 'Statonstart.js');
+const input = load('coojainput.js', 'coojaonstart.js');
+
+const ids = new Map();
+function jsonIngest(m) {
+    const payload = JSON.parse(m.payload.toString());
+    const sender = m.topic.split('/')[2];
+    const members = payload.members || [];
+    members.push(sender);
+    for (const member of members) {
+        if (!ids.has(member)) {
+            ids.set(member, ids.size);
+        }
+    }
+    return ids.get(sender);
+}
+
+measure('json', jsonIngest);
+measure('ingest', (m) => input({ topic: m.topic, payload: m.payload }));
+measure('full path', (m) => {
+    const msg = input({ topic: m.topic, payload: m.payload });
+    return msg && stats(msg);
+});
@@ -0,0 +1,114 @@
+/*
+ * Uniform grid neighbour index for the scenario tooling, the same scheme as
+ * simulator/neighbour-grid.c: cells of the radio range, so the motes in range
+ * of one are in the 3x3 cells around its own. Moving a mote only touches the
+ * grid when it crosses a cell border.
+ *
+ *   const grid = new NeighbourGrid(range);
+ *   grid.move(id, x, y);                  // insert or move
+ *   grid.forEachNeighbour(id, range, fn); // fn(other) for the motes within range
+ */
+
+// Cell keys pack both coordinates in one number, the offset keeps them positive
+const KEY_OFFSET = 1 << 20;
+const KEY_SPAN = 1 << 21;
+
+function NeighbourGrid(cellSize) {
+    this.cellSize = cellSize;
+    this.cells = new Map();   // key -> ids of the motes in the cell
+    this.x = [];
+    this.y = [];
+    this.key = [];            // Cell of each mote
+    this.slot = [];           // Index of each mote in its cell
+    this.relinked = 0;        // Cell changes so far, inserts included
+}
+
+NeighbourGrid.prototype.cellKey = function (x, y) {
+    return (Math.floor(x / this.cellSize) + KEY_OFFSET) * KEY_SPAN + Math.floor(y / this.cellSize) + KEY_OFFSET;
+};
+
+NeighbourGrid.prototype.move = function (id, x, y) {
+    const key = this.cellKey(x, y);
+    const old = this.key[id];
+    this.x[id] = x;
+    this.y[id] = y;
+    if (old === key) {
+        return;
+    }
+
+    if (old !== undefined) {
+        // Swap-remove from the previous cell
+        const members = this.cells.get(old);
+        const last = members.pop();
+        if (last !== id) {
+            members[this.slot[id]] = last;
+            this.slot[last] = this.slot[id];
+        }
+        if (members.length === 0) {
+            this.cells.delete(old);
+        }
+    }
+    let members = this.cells.get(key);
+    if (!members) {
+        members = [];
+        this.cells.set(key, members);
+    }
+    this.key[id] = key;
+    this.slot[id] = members.length;
+    members.push(id);
+    this.relinked++;
+};
+
+// Calls visit(other) for every other mote within maxDist (at most the cell size)
+NeighbourGrid.prototype.forEachNeighbour = function (id, maxDist, visit) {
+    const x = this.x[id];
+    const y = this.y[id];
+    const maxSq = maxDist * maxDist;
+    const key = this.key[id];
+
+    for (let dx = -1; dx <= 1; dx++) {
+        for (let dy = -1; dy <= 1; dy++) {
+            const members = this.cells.get(key + dx * KEY_SPAN + dy);
+            if (!members) {
+                continue;
+            }
+            for (let i = 0; i < members.length; i++) {
+                const other = members[i];
+                const ox = this.x[other] - x;
+                const oy = this.y[other] - y;
+                if (other !== id && ox * ox + oy * oy <= maxSq) {
+                    visit(other);
+                }
+            }
+        }
+    }
+};
+
+NeighbourGrid.prototype.degree = function (id, maxDist) {
+    let count = 0;
+    this.forEachNeighbour(id, maxDist, function () {
+        count++;
+    });
+    return count;
+};
+
+// Motes reachable from the given one over any number of hops
+NeighbourGrid.prototype.reachable = function (from, maxDist) {
+    const seen = new Uint8Array(this.x.length);
+    const queue = [from];
+    const self = this;
+    let count = 0;
+
+    seen[from] = 1;
+    while (queue.length > count) {
+        self.forEachNeighbour(queue[count++], maxDist, function (other) {
+            if (!seen[other]) {
+                seen[other] = 1;
+                queue.push(other);
+            }
+        });
+    }
+    return count;
+};
+
+module.exports = NeighbourGrid;
@@ -0,0 +1,109 @@
+/*
+ * Power benchmark, run by the Cooja ScriptRunner of power-<csma|tsch|low>.csc.
+ *
+ * The three scenarios are the same 28 motes on the MQTT uplink, built with the
+ * always-on CSMA MAC, with TSCH and the default Orchestra schedule, and with the
+ * power-managed mode (make POWER=low). The script sums the simple-energest
+ * summaries of every mote once the network has formed, and prints the radio
+ * and CPU duty cycles, the average current and the battery life they give.
+ */
+TIMEOUT(2400000, summary());
+
+// Summaries of the first minutes cover the network joining and are left out
+var WARMUP = 600000000; // us
+// Currents (mA) of a CC2420-class radio and MSP430-class MCU, as in uplink-benchmark.js
+var CURRENT_CPU = 1.8;
+var CURRENT_LPM = 0.0545;
+var CURRENT_TX = 17.4;
+var CURRENT_RX = 18.8;
+// Two AA cells
+var BATTERY_MAH = 2500;
+// Set when the border router announces itself
+var rootId = -1;
+
+var motes = {};
+
+function energest_ticks(line) {
+    var m = line.match(/:\s*(\d+)\//);
+    return m ? parseInt(m[1], 10) : 0;
+}
+
+function percentile(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function summary() {
+    var radio = [];
+    var cpu = [];
+    var current = [];
+    var tx = 0;
+    var rx = 0;
+
+    for (var key in motes) {
+        var t = motes[key];
+        var total = t.cpu + t.lpm;
+        if (total == 0) {
+            continue;
+        }
+        radio.push(100.0 * (t.tx + t.rx) / total);
+        cpu.push(100.0 * t.cpu / total);
+        current.push((t.cpu * CURRENT_CPU + t.lpm * CURRENT_LPM + t.tx * CURRENT_TX + t.rx * CURRENT_RX) / total);
+        tx += t.tx;
+        rx += t.rx;
+    }
+    if (radio.length == 0) {
+        log.log("No Energest summaries after the warm-up, build with BENCHMARK=1\n");
+        log.testFailed();
+        return;
+    }
+
+    var sortNumbers = function (a, b) { return a - b; };
+    radio.sort(sortNumbers);
+    cpu.sort(sortNumbers);
+    current.sort(sortNumbers);
+    var mean = function (values) {
+        var sum = 0;
+        for (var i = 0; i < values.length; i++) {
+            sum += values[i];
+        }
+        return sum / values.length;
+    };
+
+    log.log("Motes: " + radio.length + "\n");
+    log.log("Radio duty cycle %: mean " + mean(radio).toFixed(2) + ", p50 " + percentile(radio, 0.5).toFixed(2) +
+            ", p95 " + percentile(radio, 0.95).toFixed(2) + ", max " + radio[radio.length - 1].toFixed(2) +
+            " (" + (100.0 * rx / (tx + rx)).toFixed(1) + "% listening)\n");
+    log.log("CPU duty cycle %: mean " + mean(cpu).toFixed(2) + ", max " + cpu[cpu.length - 1].toFixed(2) + "\n");
+    log.log("Current mA: mean " + mean(current).toFixed(3) + ", max " + current[current.length - 1].toFixed(3) + "\n");
+    // The worst mote empties its battery first
+    log.log("Battery life days (" + BATTERY_MAH + " mAh): mean " + (BATTERY_MAH / mean(current) / 24).toFixed(1) +
+            ", worst " + (BATTERY_MAH / current[current.length - 1] / 24).toFixed(1) + "\n");
+    log.testOK();
+}
+
+while (true) {
+    YIELD();
+
+    if (msg.indexOf("Border Router started") >= 0) {
+        rootId = id;
+        continue;
+    }
+    // The border router stays powered, only the motes' own cost counts
+    if (id == rootId || time < WARMUP || msg.indexOf("Energest") < 0) {
+        continue;
+    }
+
+    var t = motes[id];
+    if (t === undefined) {
+        t = motes[id] = { cpu: 0, lpm: 0, tx: 0, rx: 0 };
+    }
+    if (msg.indexOf("CPU ") >= 0) {
+        t.cpu += energest_ticks(msg);
+    } else if (msg.indexOf("LPM ") >= 0 && msg.indexOf("Deep") < 0) {
+        t.lpm += energest_ticks(msg);
+    } else if (msg.indexOf("Radio Tx") >= 0) {
+        t.tx += energest_ticks(msg);
+    } else if (msg.indexOf("Radio Rx") >= 0) {
+        t.rx += energest_ticks(msg);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Query benchmark of the group read model (the "Group index" node), run with node:
+ *
+ *   node query-benchmark.js [motes] [queries]
+ *
+ * The node is loaded from ../Node-RED as in ingest-benchmark.js and fed the
+ * messages of the statistics node for a fleet of motes in groups of 3 to 8,
+ * then with membership churn. It prints the time per update and per query of
+ * each kind, as answered to the /groups endpoint.
+ */
+const fs = require('fs');
+const path = require('path');
+
+const MOTES = parseInt(process.argv[2] || '100000', 10);
+const QUERIES = parseInt(process.argv[3] || '100000', 10);
+const NODE_RED = path.join(__dirname, '..', 'Node-RED');
+
+function load(file, initialize) {
+    const store = new Map();
+    const context = { get: (k) => store.get(k), set: (k, v) => store.set(k, v) };
+    const flow = { get: () => undefined, set: () => {} };
+    const env = { get: () => undefined };
+    const node = { warn: () => {}, log: () => {}, error: () => {} };
+    const source = (name) => fs.readFileSync(path.join(NODE_RED, name), 'utf8');
+
+    new Function('node', 'context', 'flow', 'env', source(initialize))(node, context, flow, env);
+    const fn = new Function('msg', 'node', 'context', 'flow', 'env', source(file));
+    return (msg) => fn(msg, node, context, flow, env);
+}
+
+function address(mote) {
+    return 'fd00::212:74' + ((mote >> 16) & 0xff).toString(16).padStart(2, '0') + ':' +
+           ((mote >> 8) & 0xff).toString(16) + ':' + (mote & 0xff).toString(16);
+}
+
+const index = load('indexonmesg.js', 'indexonstart.js');
+const groups = {};
+// Stands in for the snapshots of the statistics node
+const view = {
+    get: (key) => groups[key],
+    forEach: (visit) => Object.keys(groups).forEach(key => visit(groups[key], key))
+};
+let now = 0;
+Date.now = () => now;
+
+// Groups of 3 to 8 consecutive motes, formed one after the other
+let keys = 0;
+for (let m = 0; m < MOTES; keys++) {
+    const members = [];
+    const size = 3 + keys % 6;
+    for (let i = 0; i < size && m < MOTES; i++) {
+        members.push(address(m++));
+    }
+    const key = 'group' + (keys + 1);
+    now += 10;
+    groups[key] = { name: 'group ' + (keys + 1), generation: 1, members: members, timestamp: now };
+    index({ payload: view, changed: [key], membership: [{ group: key, added: members, removed: [] }] });
+}
+
+// Churn: a mote moves from a group to the next one
+const started = process.hrtime.bigint();
+const UPDATES = 100000;
+for (let u = 0; u < UPDATES; u++) {
+    const from = 'group' + (1 + u % keys);
+    const to = 'group' + (1 + (u + 1) % keys);
+    const mote = groups[from].members.pop();
+    groups[to].members.push(mote);
+    now++;
+    index({ payload: view, changed: [from, to], membership: [
+        { group: from, added: [], removed: [mote] }, { group: to, added: [mote], removed: [] }] });
+}
+const updateNs = Number(process.hrtime.bigint() - started) / UPDATES;
+console.log('update    ' + updateNs.toFixed(0).padStart(8) + ' ns  (' + MOTES + ' motes, ' + keys + ' groups)');
+
+function measure(label, query) {
+    const start = process.hrtime.bigint();
+    let found = 0;
+    for (let q = 0; q < QUERIES; q++) {
+        const msg = index({ req: { query: query(q) }, res: {} });
+        found += msg.statusCode === 200 ? 1 : 0;
+    }
+    const ns = Number(process.hrtime.bigint() - start) / QUERIES;
+    console.log(label.padEnd(10) + ns.toFixed(0).padStart(8) + ' ns  (' + found + '/' + QUERIES + ' answered)');
+}
+
+measure('node', (q) => ({ node: address((q * 7919) % MOTES) }));
+measure('group', (q) => ({ group: 'group' + (1 + q % keys) }));
+measure('top 10', () => ({ top: '10' }));
+measure('oldest 10', () => ({ oldest: '10' }));
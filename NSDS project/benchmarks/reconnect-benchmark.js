@@ -0,0 +1,73 @@
+/*
+ * Reconnect benchmark, run by the Cooja ScriptRunner of reconnect-100.csc.
+ *
+ * The script waits until the whole fleet is connected to the broker. When the
+ * broker is then restarted (e.g. docker restart mosquitto), the first
+ * "Disconnected from the MQTT broker" opens an outage, which closes when
+ * every mote has logged "Connected to the MQTT broker!" again. For each outage
+ * it reports how long the fleet took to reconnect, the spread of the per-mote
+ * reconnection times and the number of connection attempts that hit the root.
+ */
+TIMEOUT(7200000, log.testOK());
+
+var ROOT_ID = 1;
+var FLEET = 100;
+
+var connected = {};
+var connectedCount = 0;
+var outageStart = -1;
+var attempts = 0;
+var reconnects = [];
+var outages = 0;
+
+function report() {
+    var sorted = reconnects.slice().sort(function (a, b) { return a - b; });
+    outages++;
+    log.log("Outage " + outages + ": fleet reconnected in " + ((time - outageStart) / 1000000.0).toFixed(1) +
+            " s, " + attempts + " connection attempts\n");
+    log.log("Per mote s: p50 " + sorted[Math.floor(sorted.length * 0.5)].toFixed(1) +
+            ", p95 " + sorted[Math.floor(sorted.length * 0.95)].toFixed(1) +
+            ", max " + sorted[sorted.length - 1].toFixed(1) + "\n");
+    outageStart = -1;
+    attempts = 0;
+    reconnects = [];
+}
+
+while (true) {
+    YIELD();
+
+    if (id == ROOT_ID) {
+        continue;
+    }
+
+    if (msg.indexOf("Connected to the MQTT broker!") >= 0) {
+        if (!connected[id]) {
+            connected[id] = true;
+            connectedCount++;
+            if (outageStart >= 0) {
+                reconnects.push((time - outageStart) / 1000000.0);
+            } else if (connectedCount == FLEET) {
+                log.log("Fleet connected after " + (time / 1000000.0).toFixed(1) + " s\n");
+            }
+        }
+        if (outageStart >= 0 && connectedCount == FLEET) {
+            report();
+        }
+        continue;
+    }
+
+    if (msg.indexOf("Disconnected from the MQTT broker") >= 0) {
+        if (connected[id]) {
+            connected[id] = false;
+            connectedCount--;
+        }
+        if (outageStart < 0 && connectedCount == FLEET - 1) {
+            outageStart = time;
+        }
+        continue;
+    }
+
+    if (outageStart >= 0 && msg.indexOf("Joined network! Connect attempt") >= 0) {
+        attempts++;
+    }
+}
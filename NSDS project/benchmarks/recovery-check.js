@@ -0,0 +1,123 @@
+/*
+ * Recovery check of the Node-RED backend, run with node:
+ *
+ *   node recovery-check.js
+ *
+ * The store, Cooja input and statistics nodes are loaded from ../Node-RED as in
+ * ingest-benchmark.js, with the store reading a snapshot written to a temporary
+ * GROUP_STORE_DIR: a group of four motes, generation 7, formed an hour before
+ * the restart. After the restart the motes report again one by one, and the
+ * group must keep its slot, generation, members and lifetime: the first report
+ * only names the sender's contacts and must not dismantle it. A member still
+ * silent when the grace period ends leaves the group, which stays the same
+ * generation. The clock is simulated; the check fails the run otherwise.
+ */
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const workerThreads = require('worker_threads');
+
+const NODE_RED = path.join(__dirname, '..', 'Node-RED');
+const STORE_DIR = fs.mkdtempSync(path.join(os.tmpdir(), 'group-store-'));
+const MEMBER_TIMEOUT = 120000;
+
+// Simulated clock, read by every node through Date.now()
+let clock = Date.UTC(2024, 0, 1);
+Date.now = () => clock;
+
+// Minimal function-node sandbox: shared flow context, per-node context, and
+// the modules the store node declares
+const flowStore = new Map();
+const flow = { get: (k) => flowStore.get(k), set: (k, v) => flowStore.set(k, v) };
+const env = { get: (k) => (k === 'GROUP_STORE_DIR' ? STORE_DIR : undefined) };
+const node = { warn: () => {}, log: () => {}, error: (e) => console.error(e), send: () => {} };
+const libs = { fs: fs, path: path, worker_threads: workerThreads };
+
+function load(file, initialize, finalize) {
+    const store = new Map();
+    const context = { get: (k) => store.get(k), set: (k, v) => store.set(k, v) };
+    const names = ['node', 'context', 'flow', 'env'].concat(Object.keys(libs));
+    const args = [node, context, flow, env].concat(Object.values(libs));
+    const source = (name) => fs.readFileSync(path.join(NODE_RED, name), 'utf8');
+
+    new Function(...names, source(initialize))(...args);
+    const fn = new Function('msg', ...names, source(file));
+    const close = finalize ? new Function(...names, source(finalize)) : () => {};
+    return { run: (msg) => fn(msg, ...args), stop: () => close(...args) };
+}
+
+function address(mote) {
+    return 'fd00::212:7400:' + mote.toString(16) + ':' + mote.toString(16);
+}
+
+const members = [1, 2, 3, 4].map(address);
+const formed = clock - 3600000;
+const snapshot = {
+    lsn: 1,
+    groups: {
+        group1: {
+            name: 'group 1', generation: 7, members: members.slice().sort(), cardinality: 4, maximum: 4,
+            minimum: 4, average: 4, variance: 0, index: 1, timestamp: formed, lifetime: 3540,
+            dismantle_timer: formed, last_change: formed, weight: 0, sum: 0, sum_squares: 0
+        }
+    }
+};
+fs.writeFileSync(path.join(STORE_DIR, 'snapshot.json'), JSON.stringify(snapshot));
+fs.utimesSync(path.join(STORE_DIR, 'snapshot.json'), (clock - 60000) / 1000, (clock - 60000) / 1000);
+
+const stats = load('statonmesg.js', 'Statonstart.js');
+const store = load('storeonmesg.js', 'storeonstart.js', 'storeonstop.js');
+const input = load('coojainput.js', 'coojaonstart.js');
+
+const seq = [0, 0, 0, 0, 0];
+const events = [];
+function report(mote, contacts) {
+    const payload = '{"seq": ' + (++seq[mote]) + ', "group": true, "members": [' +
+                    contacts.map(m => '"' + address(m) + '"').join(',') + ']}';
+    const msg = input.run({ topic: 'nsds_gm/contacts/' + address(mote), payload: Buffer.from(payload) });
+    const out = msg && stats.run(msg);
+    if (out) {
+        out.events.forEach(e => events.push(e.type + ' ' + e.group + ' generation ' + e.generation));
+        store.run(out);
+    }
+    return out;
+}
+
+let failures = 0;
+function check(what, ok) {
+    console.log((ok ? 'ok     ' : 'FAILED ') + what);
+    failures += ok ? 0 : 1;
+}
+
+function checkGroup(when, size) {
+    const group = flow.get('groups').group1;
+    check(when + ': group1 generation ' + group.generation + ', ' + group.members.length + ' members, lifetime ' +
+          group.lifetime.toFixed(0) + ' s',
+          group.generation === 7 && group.members.length === size && group.lifetime >= 3600);
+}
+
+clock += 1000;
+report(1, [2, 3, 4]);
+checkGroup('first report', 4);
+check('no lifecycle event after the first report (' + events.join(', ') + ')', events.length === 0);
+
+clock += 1000;
+report(2, [1, 3, 4]);
+clock += 1000;
+report(3, [1, 2, 4]);
+checkGroup('three reports', 4);
+check('no lifecycle event while members report again (' + events.join(', ') + ')', events.length === 0);
+
+// Mote 4 stays silent past the grace period
+for (let t = 0; t <= MEMBER_TIMEOUT; t += 10000) {
+    clock += 10000;
+    report(1 + (t / 10000) % 3, [1, 2, 3].filter(m => m !== 1 + (t / 10000) % 3).concat([4]));
+}
+checkGroup('grace period over', 3);
+check('silent member left (' + events.join(', ') + ')',
+      events.length === 1 && events[0] === 'leave group1 generation 7');
+
+store.stop();
+fs.rmSync(STORE_DIR, { recursive: true, force: true });
+console.log(failures === 0 ? 'Recovery check: OK' : 'Recovery check: FAILED');
+process.exit(failures === 0 ? 0 : 1);
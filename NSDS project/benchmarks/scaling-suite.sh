@@ -0,0 +1,35 @@
+#!/bin/sh
+# Standard scaling suite: generates a crowd per fleet size and runs it headless
+# in Cooja with the uplink benchmark script, then collects the summaries.
+#
+#   COOJA=<contiki-ng>/tools/cooja ./scaling-suite.sh [sizes...]
+#
+# Extra generator options (see generate-scenario.js) go in SCENARIO_OPTS, e.g.
+#   SCENARIO_OPTS="--mac tsch --mobile 0.2" ./scaling-suite.sh 100 500
+# Results are written to scaling/<size>.log and summarised in scaling/summary.txt.
+
+set -e
+
+BENCHMARKS=$(cd "$(dirname "$0")" && pwd)
+COOJA=${COOJA:-$BENCHMARKS/../../tools/cooja}
+RESULTS=${RESULTS:-$BENCHMARKS/scaling}
+SIZES=${*:-"100 250 500 1000 2000"}
+
+mkdir -p "$RESULTS"
+: > "$RESULTS/summary.txt"
+
+for size in $SIZES; do
+    scenario="$RESULTS/crowd-$size.csc"
+    node "$BENCHMARKS/generate-scenario.js" --motes "$size" $SCENARIO_OPTS --out "$scenario"
+
+    # The ScriptRunner ends the run with log.testOK() and writes COOJA.testlog
+    (cd "$COOJA" && ant run_nogui -Dargs="$scenario") > "$RESULTS/crowd-$size.cooja.out" 2>&1 || true
+    cp "$COOJA/build/COOJA.testlog" "$RESULTS/crowd-$size.log" 2>/dev/null || true
+
+    {
+        echo "== $size motes $SCENARIO_OPTS"
+        grep -E "Events:|Latency|Energy|duty cycle" "$RESULTS/crowd-$size.log" 2>/dev/null || echo "no summary, see crowd-$size.cooja.out"
+    } >> "$RESULTS/summary.txt"
+done
+
+cat "$RESULTS/summary.txt"
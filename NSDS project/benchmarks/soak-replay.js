@@ -0,0 +1,202 @@
+/*
+ * Soak replay of the Node-RED backend, run with node:
+ *
+ *   node --expose-gc soak-replay.js [--days 7] [--motes 300] [--period 30]
+ *                                   [--churn 0.05] [--pool 8192] [--trace file]
+ *
+ * The function nodes are loaded from ../Node-RED as in ingest-benchmark.js and
+ * wired as in the flow: Cooja input -> statistics -> history, notify and the
+ * event stream (the store is left out, it only writes to disk). The clock is
+ * simulated, so a week runs in minutes.
+ *
+ * Without a trace the fleet is synthetic: --motes motes in groups of four
+ * report their group mates every --period seconds, and every hour a --churn
+ * share of them leaves for good and is replaced by motes never seen before.
+ * A trace is a file of JSON lines {"time": ms, "topic": ..., "payload": ...}
+ * replayed in order.
+ *
+ * Every simulated hour the heap is measured after a full collection; the
+ * report shows it per day with the pool usage, and whether it stayed flat
+ * once the first day filled the pools.
+ */
+const fs = require('fs');
+const path = require('path');
+
+const NODE_RED = path.join(__dirname, '..', 'Node-RED');
+const HOUR = 3600000;
+
+const options = { days: 7, motes: 300, period: 30, churn: 0.05, pool: 8192, trace: null };
+for (let i = 2; i < process.argv.length; i += 2) {
+    const key = process.argv[i].replace(/^--/, '');
+    if (!(key in options)) {
+        console.error('usage: node --expose-gc soak-replay.js [--days n] [--motes n] [--period s] ' +
+                      '[--churn share] [--pool n] [--trace file]');
+        process.exit(1);
+    }
+    options[key] = key === 'trace' ? process.argv[i + 1] : Number(process.argv[i + 1]);
+}
+if (typeof global.gc !== 'function') {
+    console.warn('Run with --expose-gc for stable heap samples');
+}
+
+// Simulated clock, read by every node through Date.now()
+let clock = Date.UTC(2024, 0, 1);
+Date.now = () => clock;
+
+// Minimal function-node sandbox: shared flow context, per-node context
+const flowStore = new Map();
+const flow = { get: (k) => flowStore.get(k), set: (k, v) => flowStore.set(k, v) };
+const settings = { MEMBER_POOL_SIZE: String(options.pool), GROUP_POOL_SIZE: String(Math.ceil(options.motes / 3)) };
+const env = { get: (k) => settings[k] };
+let archived = 0;
+
+function load(file, initialize) {
+    const store = new Map();
+    const context = { get: (k) => store.get(k), set: (k, v) => store.set(k, v) };
+    const node = { warn: () => {}, log: () => {}, error: () => {}, send: () => {} };
+    const source = (name) => fs.readFileSync(path.join(NODE_RED, name), 'utf8');
+
+    new Function('node', 'context', 'flow', 'env', source(initialize))(node, context, flow, env);
+    const fn = new Function('msg', 'node', 'context', 'flow', 'env', source(file));
+    return { context: context, run: (msg) => fn(msg, node, context, flow, env) };
+}
+
+const stats = load('statonmesg.js', 'Statonstart.js');
+const input = load('coojainput.js', 'coojaonstart.js');
+const history = load('histonmesg.js', 'histonstart.js');
+const notify = load('notifyonmesg.js', 'notifyonstart.js');
+const events = load('eventsonmesg.js', 'eventsonstart.js');
+// The stable-group check is driven by the simulated clock below
+clearInterval(notify.context.get('notify').timer);
+
+function deliver(topic, payload) {
+    const msg = input.run({ topic: topic, payload: payload });
+    const out = msg && stats.run(msg);
+    if (!out) {
+        return;
+    }
+    const archive = history.run(out);
+    if (archive && archive[1]) {
+        archived += archive[1].archive.length;
+    }
+    notify.run(out);
+    events.run(out);
+}
+
+function address(mote) {
+    return 'fd00::212:74' + ((mote >> 16) & 0xff).toString(16).padStart(2, '0') + ':' +
+           ((mote >> 8) & 0xff).toString(16) + ':' + (mote & 0xff).toString(16);
+}
+
+// Synthetic fleet: position p is in the group of positions 4 * floor(p / 4) to
+// +3, a mote leaving hands its position to a new one
+const fleet = [];
+let nextMote = 0;
+for (let p = 0; p < options.motes; p++) {
+    fleet.push(nextMote++);
+}
+
+function groupMates(p) {
+    const first = p - p % 4;
+    const mates = [];
+    for (let q = first; q < Math.min(first + 4, fleet.length); q++) {
+        if (q !== p) {
+            mates.push('"' + address(fleet[q]) + '"');
+        }
+    }
+    return mates;
+}
+
+function churn() {
+    const leaving = Math.round(options.churn * fleet.length);
+    for (let i = 0; i < leaving; i++) {
+        fleet[Math.floor(Math.random() * fleet.length)] = nextMote++;
+    }
+}
+
+// Heap samples, one per simulated hour
+const samples = [];
+function sample() {
+    if (typeof global.gc === 'function') {
+        global.gc();
+    }
+    const interned = flow.get('memberIds');
+    samples.push({
+        heap: process.memoryUsage().heapUsed,
+        members: interned.size,
+        highWater: interned.highWater(),
+        rejected: interned.rejected,
+        evicted: flow.get('contactGraph').evicted,
+        notified: notify.context.get('notify').sent.size
+    });
+}
+
+function runSynthetic() {
+    const start = clock;
+    const end = start + options.days * 24 * HOUR;
+    const step = options.period * 1000 / options.motes;
+    let nextHour = start + HOUR;
+
+    for (let p = 0; clock < end; p = (p + 1) % fleet.length) {
+        clock += step;
+        const topic = 'nsds_gm/contacts/' + address(fleet[p]);
+        deliver(topic, Buffer.from('{"group": true, "members": [' + groupMates(p).join(',') + ']}'));
+        if (clock >= nextHour) {
+            notify.context.get('notify').check();
+            churn();
+            sample();
+            nextHour += HOUR;
+        }
+    }
+}
+
+function runTrace(file) {
+    let nextHour = -1;
+    for (const line of fs.readFileSync(file, 'utf8').split('\n')) {
+        if (line.trim().length === 0) {
+            continue;
+        }
+        const record = JSON.parse(line);
+        clock = record.time;
+        if (nextHour < 0) {
+            nextHour = clock + HOUR;
+        }
+        const payload = typeof record.payload === 'string' ? record.payload : JSON.stringify(record.payload);
+        deliver(record.topic, Buffer.from(payload));
+        while (clock >= nextHour) {
+            notify.context.get('notify').check();
+            sample();
+            nextHour += HOUR;
+        }
+    }
+}
+
+const started = process.hrtime.bigint();
+if (options.trace) {
+    runTrace(options.trace);
+} else {
+    runSynthetic();
+}
+const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+const mb = (bytes) => (bytes / 1048576).toFixed(1).padStart(7);
+console.log('day   heap MB  members  high water  evicted  rejected  notify map');
+for (let h = 23; h < samples.length; h += 24) {
+    const s = samples[h];
+    console.log(String(Math.floor(h / 24) + 1).padStart(3) + '  ' + mb(s.heap) + String(s.members).padStart(9) +
+                String(s.highWater).padStart(12) + String(s.evicted).padStart(9) +
+                String(s.rejected).padStart(10) + String(s.notified).padStart(12));
+}
+console.log('Motes seen ' + (options.trace ? 'in the trace' : nextMote) + ', history journal entries ' +
+            archived + ', ' + seconds.toFixed(1) + ' s');
+
+// The first day fills the pools, the heap must not grow past it
+if (samples.length > 48) {
+    const settled = samples.slice(24).map(s => s.heap);
+    const first = settled.slice(0, 24).reduce((a, b) => Math.max(a, b), 0);
+    const last = settled.slice(-24).reduce((a, b) => Math.max(a, b), 0);
+    const growth = (last - first) / first;
+    console.log('Heap after day 1: ' + mb(first).trim() + ' MB peak on day 2, ' + mb(last).trim() +
+                ' MB peak on the last day (' + (growth * 100).toFixed(1) + '%): ' +
+                (growth < 0.1 ? 'flat' : 'GROWING'));
+}
@@ -0,0 +1,98 @@
+/*
+ * Uplink benchmark, run by the Cooja ScriptRunner of uplink-mqtt.csc, uplink-udp.csc
+ * and the MAC comparison scenarios mac-<csma|tsch>-<28|200>.csc.
+ *
+ * Every mote logs "Uplink event seq=N" when it hands an event to the uplink and
+ * "Uplink ack seq=N" when the event is confirmed (PUBACK from the broker in MQTT
+ * mode, ACK from the border-router bridge in UDP mode). The script pairs them to
+ * measure delivery latency, and sums the simple-energest summaries to estimate
+ * the energy spent per delivered event and the radio duty cycle of the motes.
+ */
+TIMEOUT(1800000, summary());
+
+// Currents (mA) and supply voltage of a CC2420-class radio and MSP430-class MCU
+var CURRENT_CPU = 1.8;
+var CURRENT_LPM = 0.0545;
+var CURRENT_TX = 17.4;
+var CURRENT_RX = 18.8;
+var VOLTAGE = 3.0;
+var ENERGEST_SECOND = 32768;
+// Set when the border router announces itself
+var rootId = -1;
+
+var pending = {};
+var latencies = [];
+var events = 0;
+var drops = 0;
+var ticks = { cpu: 0, lpm: 0, tx: 0, rx: 0 };
+
+function energest_ticks(line) {
+    var m = line.match(/:\s*(\d+)\//);
+    return m ? parseInt(m[1], 10) : 0;
+}
+
+function summary() {
+    var sorted = latencies.slice().sort(function (a, b) { return a - b; });
+    var sum = 0;
+    for (var i = 0; i < sorted.length; i++) {
+        sum += sorted[i];
+    }
+    var mj = (ticks.cpu * CURRENT_CPU + ticks.lpm * CURRENT_LPM +
+              ticks.tx * CURRENT_TX + ticks.rx * CURRENT_RX) * VOLTAGE / ENERGEST_SECOND;
+
+    log.log("Events: " + events + ", delivered: " + sorted.length + ", dropped: " + drops +
+            (events > 0 ? ", PDR " + (100.0 * sorted.length / events).toFixed(1) + "%" : "") + "\n");
+    if (sorted.length > 0) {
+        log.log("Latency ms: mean " + (sum / sorted.length).toFixed(1) +
+                ", p50 " + sorted[Math.floor(sorted.length * 0.5)].toFixed(1) +
+                ", p95 " + sorted[Math.floor(sorted.length * 0.95)].toFixed(1) +
+                ", max " + sorted[sorted.length - 1].toFixed(1) + "\n");
+        log.log("Energy mJ: total " + mj.toFixed(1) + ", per event " + (mj / sorted.length).toFixed(3) + "\n");
+    }
+    if (ticks.cpu + ticks.lpm > 0) {
+        log.log("Radio duty cycle: " + (100.0 * (ticks.tx + ticks.rx) / (ticks.cpu + ticks.lpm)).toFixed(2) + "%\n");
+    }
+    log.testOK();
+}
+
+while (true) {
+    YIELD();
+
+    if (msg.indexOf("Border Router started") >= 0) {
+        rootId = id;
+        continue;
+    }
+
+    var m = msg.match(/Uplink event seq=(\d+)/);
+    if (m) {
+        pending[id + ":" + m[1]] = time;
+        events++;
+        continue;
+    }
+
+    m = msg.match(/Uplink ack seq=(\d+)/);
+    if (m && pending[id + ":" + m[1]] !== undefined) {
+        latencies.push((time - pending[id + ":" + m[1]]) / 1000.0);
+        delete pending[id + ":" + m[1]];
+        continue;
+    }
+
+    if (msg.indexOf("Uplink drop") >= 0) {
+        drops++;
+        continue;
+    }
+
+    // The border router forwards for everybody, only the motes' own cost counts
+    if (id == rootId || msg.indexOf("Energest") < 0) {
+        continue;
+    }
+    if (msg.indexOf("CPU ") >= 0) {
+        ticks.cpu += energest_ticks(msg);
+    } else if (msg.indexOf("LPM ") >= 0 && msg.indexOf("Deep") < 0) {
+        ticks.lpm += energest_ticks(msg);
+    } else if (msg.indexOf("Radio Tx") >= 0) {
+        ticks.tx += energest_ticks(msg);
+    } else if (msg.indexOf("Radio Rx") >= 0) {
+        ticks.rx += energest_ticks(msg);
+    }
+}
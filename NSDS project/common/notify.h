@@ -0,0 +1,28 @@
+#ifndef NOTIFY_H_
+#define NOTIFY_H_
+
+#include "contiki.h"
+
+// Downlink from the backend to a mote, published on nsds_gm/notify/<address>
+#define NOTIFY_VERSION 1
+
+// Bounds a mote accepts for the pushed parameters, in seconds
+#define NOTIFY_BEACON_MIN 5
+#define NOTIFY_BEACON_MAX 120
+
+// Parameter value that restores what the mote was compiled with, which
+// depends on its contact profile (CONTACT_CONF_SEND_INTERVAL and
+// CONTACT_CONF_INACTIVITY_THRESHOLD)
+#define NOTIFY_COMPILED_DEFAULT 0xff
+
+// Fixed 4-byte message; a zero parameter leaves the current value unchanged,
+// NOTIFY_COMPILED_DEFAULT restores the compiled one
+typedef struct notify_msg
+{
+    uint8_t version;
+    uint8_t group;           // Group slot the mote belongs to, 0 when in no group
+    uint8_t beacon_interval; // Seconds between neighbour beacons
+    uint8_t contact_timeout; // Seconds without beacons before a contact is dropped
+} notify_msg_t;
+
+#endif /* NOTIFY_H_ */
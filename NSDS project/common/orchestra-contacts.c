@@ -0,0 +1,74 @@
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/packetbuf.h"
+
+#include "tsch-schedule.h"
+
+// Orchestra rule giving the contact beacons their own shared slots, so that
+// they stop contending with RPL and ND broadcasts in the common slotframe
+
+static uint16_t slotframe_handle;
+static uint16_t channel_offset;
+static struct tsch_slotframe *sf_beacons;
+
+// Spreads the beacons of a crowd over the shared slots by receiver
+static uint16_t beacon_timeslot(const linkaddr_t *addr)
+{
+    return addr->u8[LINKADDR_SIZE - 1] % CONTACT_BEACON_SLOTS;
+}
+
+static int select_packet(uint16_t *slotframe, uint16_t *timeslot, uint16_t *channel_offset_ptr)
+{
+    const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+    if (packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) != FRAME802154_DATAFRAME ||
+        linkaddr_cmp(dest, &linkaddr_null) ||
+        packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) != CONTACT_BEACON_MAX_TX)
+    {
+        return 0;
+    }
+
+    if (slotframe != NULL)
+    {
+        *slotframe = slotframe_handle;
+    }
+    if (timeslot != NULL)
+    {
+        *timeslot = beacon_timeslot(dest);
+    }
+    if (channel_offset_ptr != NULL)
+    {
+        *channel_offset_ptr = channel_offset;
+    }
+    return 1;
+}
+
+static void init(uint16_t sf_handle)
+{
+    uint16_t slot;
+
+    slotframe_handle = sf_handle;
+    channel_offset = sf_handle;
+    sf_beacons = tsch_schedule_add_slotframe(slotframe_handle, CONTACT_BEACON_PERIOD);
+
+    // Every node may send in any of the beacon slots. It listens in all of them,
+    // or only in its own one in the power-managed build.
+    for (slot = 0; slot < CONTACT_BEACON_SLOTS; slot++)
+    {
+        uint8_t options = LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED;
+#if POWER_CONF_LOW
+        if (slot != beacon_timeslot(&linkaddr_node_addr))
+        {
+            options = LINK_OPTION_TX | LINK_OPTION_SHARED;
+        }
+#endif
+        tsch_schedule_add_link(sf_beacons, options, LINK_TYPE_NORMAL, &tsch_broadcast_address, slot,
+                               channel_offset, 1);
+    }
+}
+
+struct orchestra_rule contact_beacons = {
+    .init = init,
+    .select_packet = select_packet,
+    .name = "contact beacons",
+};
@@ -0,0 +1,60 @@
+#ifndef TSCH_SCHEDULE_H_
+#define TSCH_SCHEDULE_H_
+
+// TSCH configuration shared by the border router, the motes and the signalers
+// (make MAC=tsch). Included from each project-conf.h.
+
+// Contact beacons are sent with this many MAC transmissions at most, which is
+// also how the Orchestra rule tells them apart from the other unicast frames
+#define CONTACT_BEACON_MAX_TX 2
+
+#if MAC_CONF_WITH_TSCH
+
+// Every node starts scanning at boot, the DODAG root becomes the coordinator
+#define TSCH_CONF_AUTOSTART 1
+
+// Orchestra: EBs on the time source slotframe, shared slots for the contact
+// beacons, a unicast slot per neighbour for the traffic to the RPL parent
+// (group reports towards the root), and the common shared slotframe for the
+// rest. The first rule selecting a frame wins: the beacon rule comes before
+// the unicast one, which would otherwise also take the beacons sent to the
+// parent. It only selects CONTACT_BEACON_MAX_TX frames, so the rest of the
+// unicast traffic still goes to the unicast rule.
+#define ORCHESTRA_CONF_RULES { &eb_per_time_source, &contact_beacons, &unicast_per_neighbor_rpl_ns, &default_common }
+
+// Contact beacon slotframe: a prime length, so it does not keep colliding with
+// the other slotframes, and a few shared slots picked by receiver
+#ifndef CONTACT_BEACON_CONF_PERIOD
+#if POWER_CONF_LOW
+#define CONTACT_BEACON_PERIOD 53
+#else
+#define CONTACT_BEACON_PERIOD 23
+#endif
+#else
+#define CONTACT_BEACON_PERIOD CONTACT_BEACON_CONF_PERIOD
+#endif
+#ifndef CONTACT_BEACON_CONF_SLOTS
+#define CONTACT_BEACON_SLOTS 3
+#else
+#define CONTACT_BEACON_SLOTS CONTACT_BEACON_CONF_SLOTS
+#endif
+
+#if POWER_CONF_LOW
+// Power-managed build (make POWER=low): longer slotframes, so that a node
+// listens in fewer slots per second. Between beacon rounds the unicast slots
+// to the parent and the common shared slot see little traffic. A node only
+// listens in the beacon slot of its own address and sends to a neighbour in
+// the slot of the neighbour's address, as with receiver-based low-power
+// listening. Every node of the network must be built with the same setting.
+#define ORCHESTRA_CONF_UNICAST_PERIOD 47
+#define ORCHESTRA_CONF_COMMON_SHARED_PERIOD 61
+#endif
+
+#ifndef __ASSEMBLER__
+struct orchestra_rule;
+extern struct orchestra_rule contact_beacons;
+#endif
+
+#endif /* MAC_CONF_WITH_TSCH */
+
+#endif /* TSCH_SCHEDULE_H_ */
@@ -0,0 +1,110 @@
+#include "contiki.h"
+#include "string.h"
+
+#include "uplink-framing.h"
+
+#define SEQ_PREFIX "{\"seq\": "
+
+static uint32_t body_hash(const char *body, uint16_t len)
+{
+    uint32_t h = 2166136261UL;
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = (h ^ (uint8_t)body[i]) * 16777619UL;
+    }
+    return h;
+}
+
+// Function to split an event into its seq and the body after it. The seq must
+// read back the same, without leading zeros, for the host to rebuild the event.
+// Returns the length of the prefix, or 0 when the event does not start with one.
+static uint16_t split_seq(const char *payload, uint16_t len, uint16_t *seq)
+{
+    uint16_t i = sizeof(SEQ_PREFIX) - 1;
+    uint32_t value = 0;
+
+    if (len < i || memcmp(payload, SEQ_PREFIX, i) != 0)
+    {
+        return 0;
+    }
+    if (i < len && payload[i] == '0' && i + 1 < len && payload[i + 1] != ',')
+    {
+        return 0;
+    }
+    for (; i < len && payload[i] >= '0' && payload[i] <= '9' && value <= 0xffff; i++)
+    {
+        value = value * 10 + (payload[i] - '0');
+    }
+    if (value > 0xffff || i == sizeof(SEQ_PREFIX) - 1 || i + 2 > len || payload[i] != ',' || payload[i + 1] != ' ')
+    {
+        return 0;
+    }
+    *seq = value;
+    return i + 2;
+}
+
+uint16_t uplink_framing_encode(uplink_framing_topic_t *topic, uint8_t id, uint8_t epoch, const char *suffix,
+                               const char *payload, uint16_t len, uint8_t *frame)
+{
+    uint16_t seq = 0;
+    uint16_t prefix = split_seq(payload, len, &seq);
+    uint16_t body_len = len - prefix;
+    uint16_t n = 3;
+    uint8_t flags = 0;
+    uint32_t hash;
+
+    frame[0] = UPLINK_FRAME_MARKER;
+    frame[2] = id;
+
+    if (topic->epoch != epoch)
+    {
+        size_t suffix_len = strlen(suffix);
+        if (suffix_len > UPLINK_FRAME_SUFFIX_MAX)
+        {
+            suffix_len = UPLINK_FRAME_SUFFIX_MAX;
+        }
+        frame[n++] = suffix_len;
+        memcpy(frame + n, suffix, suffix_len);
+        n += suffix_len;
+        topic->epoch = epoch;
+        topic->body_len = 0;
+        flags |= UPLINK_FRAME_DEFINE;
+    }
+
+    if (prefix == 0 || body_len == 0 || body_len > 0xff)
+    {
+        frame[1] = flags | UPLINK_FRAME_RAW;
+        memcpy(frame + n, payload, len);
+        return n + len;
+    }
+
+    if (topic->body_len != 0 && seq == (uint16_t)(topic->seq + 1))
+    {
+        flags |= UPLINK_FRAME_NEXT_SEQ;
+    }
+    else
+    {
+        frame[n++] = seq >> 8;
+        frame[n++] = seq & 0xff;
+    }
+    topic->seq = seq;
+
+    // The host checks the seq and the body it rebuilds against this byte, the
+    // serial line has no checksum of its own
+    hash = body_hash(payload + prefix, body_len);
+    frame[n++] = UPLINK_FRAME_CHECK(hash, seq);
+
+    // The host rebuilds a repeated report from the last body it got
+    if (topic->body_len == body_len && topic->body_hash == hash)
+    {
+        frame[1] = flags | UPLINK_FRAME_REPEAT;
+        return n;
+    }
+    frame[1] = flags | UPLINK_FRAME_REPORT;
+    memcpy(frame + n, payload + prefix, body_len);
+    topic->body_hash = hash;
+    topic->body_len = body_len;
+    return n + body_len;
+}
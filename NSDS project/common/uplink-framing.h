@@ -0,0 +1,59 @@
+#ifndef UPLINK_FRAMING_H_
+#define UPLINK_FRAMING_H_
+
+#include "contiki.h"
+
+#include "uplink.h"
+
+// Compressed framing of the bridged events between the border router and the
+// host bridge (make UPLINK=udp FRAMING=compressed, see host-bridge.js). Events
+// leave the border router as SLIP frames of their own on the tunslip6 serial
+// line instead of MQTT publishes over TCP/IPv6; the host bridge takes them out
+// of the stream, publishes them to the broker and hands the rest to tunslip6.
+//
+// Frame: marker, kind and flags, topic id, then
+//   [define]  length byte and topic suffix (mote address), when flagged
+//   REPORT    [seq] check body: the event is "{\"seq\": <seq>, " and the body
+//   REPEAT    [seq] check: same body as the last report on the topic
+//   RAW       payload as is, for events that do not start with a seq
+// seq is 2 bytes in network order, left out when it follows the previous one.
+// check is UPLINK_FRAME_CHECK of the FNV-1a hash of the body and of the seq:
+// a host that missed a frame drops the topic until it is defined again rather
+// than rebuild a wrong event. A definition resets what the host knows of the
+// topic id.
+
+// Never the first byte of an IPv6 packet, nor one of the tunslip6 commands
+#define UPLINK_FRAME_MARKER '#'
+
+#define UPLINK_FRAME_REPORT 0
+#define UPLINK_FRAME_REPEAT 1
+#define UPLINK_FRAME_RAW 2
+#define UPLINK_FRAME_KIND 0x0f
+
+#define UPLINK_FRAME_DEFINE 0x80   // Topic suffix follows the topic id
+#define UPLINK_FRAME_NEXT_SEQ 0x40 // seq left out, it is the previous one + 1
+
+// The hash is folded: the low byte of FNV-1a only depends on the low bytes
+#define UPLINK_FRAME_CHECK(hash, seq) \
+    ((uint8_t)((hash) ^ ((hash) >> 8) ^ ((hash) >> 16) ^ ((hash) >> 24) ^ (seq) ^ ((seq) >> 8)))
+
+#define UPLINK_FRAME_SUFFIX_MAX 40
+#define UPLINK_FRAME_MAX (3 + 1 + UPLINK_FRAME_SUFFIX_MAX + 3 + UPLINK_MAX_PAYLOAD)
+
+// What the host bridge knows of a topic, as seen from the border router
+typedef struct uplink_framing_topic
+{
+    uint32_t body_hash; // FNV-1a of the last body sent in full
+    uint16_t seq;       // seq of the last report
+    uint8_t body_len;   // Length of that body, 0 when the host has none
+    uint8_t epoch;      // Definition epoch the host last got, 0 for never
+} uplink_framing_topic_t;
+
+// Encodes an event of the topic into frame, which holds UPLINK_FRAME_MAX bytes.
+// The topic is defined again when its epoch differs from the current one, so a
+// restarted host bridge learns every active topic within an epoch. Returns the
+// frame length.
+uint16_t uplink_framing_encode(uplink_framing_topic_t *topic, uint8_t id, uint8_t epoch, const char *suffix,
+                               const char *payload, uint16_t len, uint8_t *frame);
+
+#endif /* UPLINK_FRAMING_H_ */
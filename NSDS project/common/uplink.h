@@ -0,0 +1,34 @@
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include "contiki.h"
+
+// Lightweight UDP uplink shared by the motes and the border-router bridge
+#define UPLINK_UDP_PORT 5678
+
+// Largest event payload: a group report of the contact profile the motes are
+// built with, CONTACT_CONF_APP_BUFFER_SIZE of mqtt-mote/project-conf.h. The
+// border router is built with the same PROFILE for its bridge to take them.
+#ifdef UPLINK_CONF_MAX_PAYLOAD
+#define UPLINK_MAX_PAYLOAD UPLINK_CONF_MAX_PAYLOAD
+#elif CONTACT_CONF_PROFILE == 3 /* dense */
+#define UPLINK_MAX_PAYLOAD 1024
+#else /* tiny, standard */
+#define UPLINK_MAX_PAYLOAD 256
+#endif
+
+#define UPLINK_MSG_EVENT 0
+#define UPLINK_MSG_ACK 1
+
+// Every datagram starts with this header; ACKs carry the header only
+typedef struct uplink_hdr
+{
+    uint8_t type;
+    uint8_t flags;
+    uint16_t seq; // Network byte order
+} uplink_hdr_t;
+
+// Serial-number comparison (RFC 1982) for 16-bit sequence numbers
+#define UPLINK_SEQ_NEWER(a, b) ((int16_t)((uint16_t)(a) - (uint16_t)(b)) > 0)
+
+#endif /* UPLINK_H_ */
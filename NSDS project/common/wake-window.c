@@ -0,0 +1,26 @@
+#include "contiki.h"
+#include "random.h"
+
+#include "wake-window.h"
+
+// Offset of the windows of this node from the clock origin
+static clock_time_t phase;
+
+void wake_window_init(void)
+{
+    phase = random_rand() % WAKE_WINDOW_PERIOD;
+}
+
+clock_time_t wake_window_delay(clock_time_t delay)
+{
+    // Times are shifted by a whole period, so that removing the phase cannot wrap
+    clock_time_t now = clock_time() + WAKE_WINDOW_PERIOD;
+    clock_time_t target = now + delay + WAKE_WINDOW_PERIOD / 2 - phase;
+    clock_time_t start = target - target % WAKE_WINDOW_PERIOD + phase;
+
+    if (start <= now)
+    {
+        start += WAKE_WINDOW_PERIOD;
+    }
+    return start - now;
+}
@@ -0,0 +1,36 @@
+#ifndef WAKE_WINDOW_H_
+#define WAKE_WINDOW_H_
+
+#include "contiki.h"
+
+// Wake windows of the power-managed build (make POWER=low). TSCH duty-cycles
+// the radio (see tsch-schedule.h); on top of it the periodic work of a node,
+// its beacon rounds, the contact expiry check and the MQTT state machine and
+// keepalive, starts on the boundaries of windows WAKE_WINDOW_PERIOD apart, so
+// the node wakes once per window instead of once per timer. Each node picks
+// its own phase, neighbours do not all wake in the same instant. Without
+// POWER=low the delays are left untouched.
+
+#ifndef WAKE_WINDOW_CONF_PERIOD
+#define WAKE_WINDOW_CONF_PERIOD 10 /* s */
+#endif
+#define WAKE_WINDOW_PERIOD (CLOCK_SECOND * WAKE_WINDOW_CONF_PERIOD)
+
+// MQTT keepalive, a whole number of windows: the connection is opened at a
+// window boundary, so the pings fall in windows too (s)
+#ifndef WAKE_WINDOW_CONF_KEEP_ALIVE
+#define WAKE_WINDOW_CONF_KEEP_ALIVE (6 * WAKE_WINDOW_CONF_PERIOD)
+#endif
+
+#if POWER_CONF_LOW
+void wake_window_init(void);
+
+// Delay from now to the window boundary closest to now + delay, at least the
+// next boundary
+clock_time_t wake_window_delay(clock_time_t delay);
+#else
+#define wake_window_init()
+#define wake_window_delay(delay) (delay)
+#endif
+
+#endif /* WAKE_WINDOW_H_ */
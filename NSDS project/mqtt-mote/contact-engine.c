@@ -0,0 +1,372 @@
+#include "contiki.h"
+#include "string.h"
+
+#include "net/ipv6/uip.h"
+
+#include "contact-engine.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "Contacts"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+static void mutual_set(contact_t *contact, uint8_t slot)
+{
+    contact->mutual_contacts[slot >> 3] |= 1 << (slot & 7);
+}
+
+static void mutual_clear(contact_t *contact, uint8_t slot)
+{
+    contact->mutual_contacts[slot >> 3] &= ~(1 << (slot & 7));
+}
+
+static int is_used(const contact_engine_t *engine, uint8_t slot)
+{
+    return engine->used[slot >> 3] & (1 << (slot & 7));
+}
+
+static int should_be_mutual_contact(const contact_engine_t *engine, const contact_t *contact1,
+                                    const contact_t *contact2, clock_time_t now)
+{
+    return contact1->in_proximity && contact2->in_proximity &&
+           (now - contact1->last_seen <= engine->contact_timeout) &&
+           (now - contact2->last_seen <= engine->contact_timeout);
+}
+
+#if CONTACT_HASH_INDEX
+static unsigned contact_hash(const uip_ipaddr_t *addr)
+{
+    // The interface identifier is what differs between the motes of a network
+    unsigned h = 0;
+    int i;
+    for (i = 8; i < 16; i++)
+    {
+        h = h * 31 + addr->u8[i];
+    }
+    return h & (CONTACT_INDEX_SIZE - 1);
+}
+
+// Function to drop a contact from the index, moving back the entries of its
+// probe sequence so that lookups never stop at the hole
+static void contact_index_remove(contact_engine_t *engine, const contact_t *contact)
+{
+    uint8_t *index = engine->index;
+    unsigned hole = contact_hash(&contact->ipaddr);
+    unsigned i;
+
+    while (index[hole] != contact->slot + 1)
+    {
+        hole = (hole + 1) & (CONTACT_INDEX_SIZE - 1);
+    }
+    index[hole] = 0;
+
+    for (i = (hole + 1) & (CONTACT_INDEX_SIZE - 1); index[i] != 0; i = (i + 1) & (CONTACT_INDEX_SIZE - 1))
+    {
+        unsigned home = contact_hash(&engine->contacts[index[i] - 1].ipaddr);
+        // Move the entry if the hole lies between its home bucket and its bucket
+        if (((i - home) & (CONTACT_INDEX_SIZE - 1)) >= ((i - hole) & (CONTACT_INDEX_SIZE - 1)))
+        {
+            index[hole] = index[i];
+            index[i] = 0;
+            hole = i;
+        }
+    }
+}
+
+// Function to find a contact through the index, or the bucket to insert it in
+static contact_t *find_contact(contact_engine_t *engine, const uip_ipaddr_t *addr, unsigned *bucket)
+{
+    unsigned i = contact_hash(addr);
+
+    while (engine->index[i] != 0)
+    {
+        contact_t *c = &engine->contacts[engine->index[i] - 1];
+        if (uip_ipaddr_cmp(&c->ipaddr, addr))
+        {
+            return c;
+        }
+        i = (i + 1) & (CONTACT_INDEX_SIZE - 1);
+    }
+    *bucket = i;
+    return NULL;
+}
+#else
+static contact_t *find_contact(contact_engine_t *engine, const uip_ipaddr_t *addr, unsigned *bucket)
+{
+    contact_t *c;
+
+    (void)bucket; /* No index: the scan has no bucket to return */
+    for (c = contact_engine_next(engine, NULL); c != NULL; c = contact_engine_next(engine, c))
+    {
+        if (uip_ipaddr_cmp(&c->ipaddr, addr))
+        {
+            return c;
+        }
+    }
+    return NULL;
+}
+#endif
+
+static contact_t *alloc_contact(contact_engine_t *engine)
+{
+    int i;
+
+    for (i = 0; i < CONTACT_SET_BYTES; i++)
+    {
+        if (engine->used[i] != 0xff)
+        {
+            uint8_t slot = i * 8;
+            while (engine->used[i] & (1 << (slot & 7)))
+            {
+                slot++;
+            }
+            if (slot >= MAX_CONTACTS)
+            {
+                break;
+            }
+            engine->used[i] |= 1 << (slot & 7);
+            engine->contacts[slot].slot = slot;
+            engine->pool.allocs++;
+            if (++engine->pool.in_use > engine->pool.high_water)
+            {
+                engine->pool.high_water = engine->pool.in_use;
+            }
+            return &engine->contacts[slot];
+        }
+    }
+    return NULL;
+}
+
+// Function to tell whether an entry was handed out by this engine's pool and
+// not freed since: a pointer to the start of an allocated slot
+static int owns_contact(const contact_engine_t *engine, const contact_t *contact)
+{
+    uintptr_t offset = (uintptr_t)contact - (uintptr_t)engine->contacts;
+
+    if ((uintptr_t)contact < (uintptr_t)engine->contacts || offset >= sizeof(engine->contacts) ||
+        offset % sizeof(contact_t) != 0)
+    {
+        return 0;
+    }
+    return is_used(engine, offset / sizeof(contact_t)) && contact->slot == offset / sizeof(contact_t);
+}
+
+// Function to free a contact and drop it from the mutual contacts of the others
+static int remove_contact(contact_engine_t *engine, contact_t *contact)
+{
+    contact_t *other;
+
+    // A double free or a foreign entry would clear the bits of a live contact
+    if (!owns_contact(engine, contact))
+    {
+        engine->pool.bad_frees++;
+        LOG_ERR("Refused to free a contact the pool does not own\n");
+        return 0;
+    }
+
+    for (other = contact_engine_next(engine, NULL); other != NULL; other = contact_engine_next(engine, other))
+    {
+        mutual_clear(other, contact->slot);
+    }
+#if CONTACT_HASH_INDEX
+    contact_index_remove(engine, contact);
+#endif
+    engine->used[contact->slot >> 3] &= ~(1 << (contact->slot & 7));
+    engine->pool.in_use--;
+    engine->pool.frees++;
+    return 1;
+}
+
+// Function to update the mutual contacts of a contact that was just seen.
+// The other pairs only grow older, so they cannot have become mutual.
+static void update_mutual_contacts(contact_engine_t *engine, contact_t *current_contact, clock_time_t now)
+{
+    contact_t *other;
+
+    for (other = contact_engine_next(engine, NULL); other != NULL; other = contact_engine_next(engine, other))
+    {
+        if (other != current_contact && should_be_mutual_contact(engine, current_contact, other, now))
+        {
+            mutual_set(current_contact, other->slot);
+            mutual_set(other, current_contact->slot);
+        }
+    }
+}
+
+// Function to fold a beacon's signal into the contact's moving averages and
+// apply the hysteresis: a neighbour must come closer than the enter thresholds
+// to become a contact and move away past the leave thresholds to stop being one.
+// Returns 1 when the neighbour just left proximity.
+static int update_proximity(contact_t *contact, int16_t rssi, uint8_t lqi)
+{
+    contact->rssi_avg += (rssi * PROXIMITY_SCALE - contact->rssi_avg) / (1 << PROXIMITY_EWMA_SHIFT);
+    contact->lqi_avg += (lqi * PROXIMITY_SCALE - contact->lqi_avg) / (1 << PROXIMITY_EWMA_SHIFT);
+
+    if (!contact->in_proximity &&
+        contact->rssi_avg >= PROXIMITY_RSSI_ENTER * PROXIMITY_SCALE &&
+        contact->lqi_avg >= PROXIMITY_LQI_ENTER * PROXIMITY_SCALE)
+    {
+        contact->in_proximity = 1;
+        LOG_INFO("Contact near: ");
+        LOG_INFO_6ADDR(&contact->ipaddr);
+        LOG_INFO_("\n");
+    }
+    else if (contact->in_proximity &&
+             (contact->rssi_avg < PROXIMITY_RSSI_LEAVE * PROXIMITY_SCALE ||
+              contact->lqi_avg < PROXIMITY_LQI_LEAVE * PROXIMITY_SCALE))
+    {
+        contact->in_proximity = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void contact_engine_init(contact_engine_t *engine, contact_engine_callback_t departure)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->contact_timeout = CONTACT_TIMEOUT;
+    engine->inactivity_threshold = CONTACT_INACTIVITY_THRESHOLD;
+    engine->departure = departure;
+}
+
+contact_t *contact_engine_find(contact_engine_t *engine, const uip_ipaddr_t *addr)
+{
+    unsigned bucket;
+    return find_contact(engine, addr, &bucket);
+}
+
+contact_t *contact_engine_heard(contact_engine_t *engine, const uip_ipaddr_t *addr,
+                                int16_t rssi, uint8_t lqi, clock_time_t now)
+{
+    unsigned bucket = 0;
+    contact_t *contact = find_contact(engine, addr, &bucket);
+    uint8_t was_in_proximity;
+
+    if (contact == NULL)
+    {
+        contact = alloc_contact(engine);
+        if (contact == NULL)
+        {
+            engine->dropped++;
+            return NULL;
+        }
+#if CONTACT_HASH_INDEX
+        engine->index[bucket] = contact->slot + 1;
+#endif
+        uip_ipaddr_copy(&contact->ipaddr, addr);
+        contact->last_seen = now;
+        contact->rssi_avg = rssi * PROXIMITY_SCALE;
+        contact->lqi_avg = lqi * PROXIMITY_SCALE;
+        contact->in_proximity = 0;
+#if CONTACT_LINK_EVIDENCE
+        contact->acks = 0;
+#endif
+        memset(contact->mutual_contacts, 0, sizeof(contact->mutual_contacts));
+    }
+
+    // Any frame keeps the entry (and its averages) alive, only close ones refresh the contact
+    contact->last_activity = now;
+    was_in_proximity = contact->in_proximity;
+    if (update_proximity(contact, rssi, lqi) && engine->departure != NULL)
+    {
+        engine->departure(engine, contact);
+    }
+    engine->changed |= was_in_proximity != contact->in_proximity;
+
+    if (contact->in_proximity)
+    {
+        contact->last_seen = now;
+        update_mutual_contacts(engine, contact, now);
+    }
+    return contact;
+}
+
+void contact_engine_expire(contact_engine_t *engine, clock_time_t now)
+{
+    contact_t *contact;
+
+    for (contact = contact_engine_next(engine, NULL); contact != NULL; contact = contact_engine_next(engine, contact))
+    {
+        if (now - contact->last_activity > engine->inactivity_threshold)
+        {
+            // Neighbours that never came close enough were never reported
+            if (contact->in_proximity)
+            {
+                engine->changed = 1;
+                if (engine->departure != NULL)
+                {
+                    engine->departure(engine, contact);
+                }
+            }
+            // Iteration goes by slot, so freeing the current one is safe
+            remove_contact(engine, contact);
+        }
+    }
+}
+
+int contact_engine_remove(contact_engine_t *engine, contact_t *contact)
+{
+    if (!remove_contact(engine, contact))
+    {
+        return 0;
+    }
+    // The slot keeps its content until it is handed out again
+    engine->changed |= contact->in_proximity;
+    return 1;
+}
+
+int contact_engine_in_proximity(const contact_engine_t *engine)
+{
+    int count = 0;
+    int slot;
+
+    for (slot = 0; slot < MAX_CONTACTS; slot++)
+    {
+        if (is_used(engine, slot) && engine->contacts[slot].in_proximity)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int contact_engine_mutual_count(const contact_t *contact)
+{
+    int count = 0;
+    int i;
+    for (i = 0; i < CONTACT_SET_BYTES; i++)
+    {
+        uint8_t bits = contact->mutual_contacts[i];
+        while (bits)
+        {
+            bits &= bits - 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+contact_t *contact_engine_next(contact_engine_t *engine, const contact_t *contact)
+{
+    int slot = contact == NULL ? 0 : contact->slot + 1;
+
+    while (slot < MAX_CONTACTS)
+    {
+        // Skip empty bytes of the allocation bitmap at once
+        if ((slot & 7) == 0 && engine->used[slot >> 3] == 0)
+        {
+            slot += 8;
+            continue;
+        }
+        if (is_used(engine, slot))
+        {
+            return &engine->contacts[slot];
+        }
+        slot++;
+    }
+    return NULL;
+}
+
+clock_time_t contact_engine_round_delay(clock_time_t period, unsigned short random)
+{
+    return period - (5 * CLOCK_SECOND) + (random % (10 * CLOCK_SECOND));
+}
@@ -0,0 +1,119 @@
+#ifndef CONTACT_ENGINE_H_
+#define CONTACT_ENGINE_H_
+
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+
+// Contact engine sizing, set by the build profile (see project-conf.h)
+#define MAX_CONTACTS CONTACT_CONF_MAX_CONTACTS
+#define CONTACT_TIMEOUT (CLOCK_SECOND * CONTACT_CONF_TIMEOUT)
+#define CONTACT_INACTIVITY_THRESHOLD (CLOCK_SECOND * CONTACT_CONF_INACTIVITY_THRESHOLD)
+#define CONTACT_HASH_INDEX CONTACT_CONF_HASH_INDEX
+#define CONTACT_LINK_EVIDENCE CONTACT_CONF_LINK_EVIDENCE
+
+// Mutual contacts are a bitset over the contact pool slots
+#define CONTACT_SET_BYTES ((MAX_CONTACTS + 7) / 8)
+#if MAX_CONTACTS > 255
+#error "Contact slots are stored in a uint8_t, MAX_CONTACTS must be at most 255"
+#endif
+
+#if CONTACT_HASH_INDEX
+// Open-addressing index from the interface identifier of a contact to its
+// slot + 1 (0 marks a free bucket), kept at most half full
+#define CONTACT_INDEX_SIZE (2 * MAX_CONTACTS)
+#if (MAX_CONTACTS & (MAX_CONTACTS - 1)) != 0
+#error "The contact index needs MAX_CONTACTS to be a power of two"
+#endif
+#endif
+
+// Proximity filter (see project-conf.h), averages kept in 1/PROXIMITY_SCALE units
+#define PROXIMITY_RSSI_ENTER PROXIMITY_CONF_RSSI_ENTER
+#define PROXIMITY_RSSI_LEAVE PROXIMITY_CONF_RSSI_LEAVE
+#define PROXIMITY_LQI_ENTER PROXIMITY_CONF_LQI_ENTER
+#define PROXIMITY_LQI_LEAVE PROXIMITY_CONF_LQI_LEAVE
+#define PROXIMITY_EWMA_SHIFT PROXIMITY_CONF_EWMA_SHIFT
+#define PROXIMITY_SCALE 16
+
+// Smallest number of contacts in proximity worth a group report
+#define CONTACT_GROUP_MIN_SIZE 3
+
+typedef struct contact
+{
+    uip_ipaddr_t ipaddr;
+    clock_time_t last_seen;
+    clock_time_t last_activity;
+    int16_t rssi_avg;     // Moving average of the beacon RSSI, dBm * PROXIMITY_SCALE
+    int16_t lqi_avg;      // Moving average of the beacon LQI, * PROXIMITY_SCALE
+    uint8_t in_proximity; // Whether the neighbour currently counts as a contact
+    uint8_t slot;         // Index of the entry in the pool
+#if CONTACT_LINK_EVIDENCE
+    uint16_t acks;        // Frames of ours the neighbour had acknowledged at the last beacon round
+#endif
+    uint8_t mutual_contacts[CONTACT_SET_BYTES]; // Slots of the mutual contacts
+} contact_t;
+
+// Occupancy of the contact pool. Entries, their mutual-contact bitsets and
+// their index buckets all live in fixed slots of the engine, so a freed slot
+// is reused as is and the pool cannot fragment.
+typedef struct contact_pool_stats
+{
+    uint8_t in_use;     // Slots allocated now
+    uint8_t high_water; // Most slots allocated at once
+    uint32_t allocs;    // Slots handed out since init
+    uint32_t frees;     // Slots given back since init
+    uint16_t bad_frees; // Frees of an entry this pool had not handed out, refused
+} contact_pool_stats_t;
+
+struct contact_engine;
+
+// Called when a contact in proximity leaves, by moving away or going silent
+typedef void (*contact_engine_callback_t)(struct contact_engine *engine, const contact_t *contact);
+
+// State of the contacts of one mote. The mote has a single engine, the host
+// simulator one per simulated mote.
+typedef struct contact_engine
+{
+    contact_t contacts[MAX_CONTACTS];
+    uint8_t used[CONTACT_SET_BYTES]; // Allocated pool slots
+#if CONTACT_HASH_INDEX
+    uint8_t index[CONTACT_INDEX_SIZE];
+#endif
+    clock_time_t contact_timeout;      // How long a sighting keeps two contacts mutual
+    clock_time_t inactivity_threshold; // How long a silent neighbour is kept
+    uint8_t changed;                   // Set when a neighbour comes into or leaves proximity
+    uint16_t dropped;                  // Neighbours ignored because the pool was full
+    contact_pool_stats_t pool;
+    contact_engine_callback_t departure;
+} contact_engine_t;
+
+void contact_engine_init(contact_engine_t *engine, contact_engine_callback_t departure);
+
+// Folds a frame heard from a neighbour into its entry, creating it if needed.
+// Returns the entry, or NULL when the pool is full.
+contact_t *contact_engine_heard(contact_engine_t *engine, const uip_ipaddr_t *addr,
+                                int16_t rssi, uint8_t lqi, clock_time_t now);
+
+// Returns the entry of a neighbour, or NULL
+contact_t *contact_engine_find(contact_engine_t *engine, const uip_ipaddr_t *addr);
+
+// Drops the neighbours silent for longer than the inactivity threshold
+void contact_engine_expire(contact_engine_t *engine, clock_time_t now);
+
+// Drops an entry without reporting a departure. Entries that are not allocated
+// from this engine are refused and counted in pool.bad_frees. Returns 1 when
+// the entry was freed.
+int contact_engine_remove(contact_engine_t *engine, contact_t *contact);
+
+// Number of neighbours currently in proximity
+int contact_engine_in_proximity(const contact_engine_t *engine);
+
+// Number of mutual contacts of a contact
+int contact_engine_mutual_count(const contact_t *contact);
+
+// Iterates over the entries: pass NULL for the first one. Returns NULL at the end.
+contact_t *contact_engine_next(contact_engine_t *engine, const contact_t *contact);
+
+// Delay until the next beacon round: the period with +-5 s of jitter
+clock_time_t contact_engine_round_delay(clock_time_t period, unsigned short random);
+
+#endif /* CONTACT_ENGINE_H_ */
@@ -0,0 +1,121 @@
+#include "contiki.h"
+#include "string.h"
+
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/link-stats.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include "link-evidence.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "Evidence"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Frames are queued from the receive path and handled in the consumer process
+static link_evidence_t queue[LINK_EVIDENCE_QUEUE_SIZE];
+static uint8_t queue_head;
+static uint8_t queue_count;
+static uint16_t dropped;
+static uint16_t multicasts;
+static struct process *consumer_process;
+
+static enum netstack_ip_action ip_input(void)
+{
+    const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+    link_evidence_t *evidence;
+
+    if (linkaddr_cmp(sender, &linkaddr_null))
+    {
+        return NETSTACK_IP_PROCESS;
+    }
+    if (queue_count == LINK_EVIDENCE_QUEUE_SIZE)
+    {
+        // The neighbour will be heard again, losing one frame only delays it
+        dropped++;
+        return NETSTACK_IP_PROCESS;
+    }
+
+    evidence = &queue[(queue_head + queue_count) % LINK_EVIDENCE_QUEUE_SIZE];
+    if (!link_evidence_address(sender, &evidence->ipaddr))
+    {
+        return NETSTACK_IP_PROCESS;
+    }
+    evidence->rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+    evidence->lqi = (uint8_t)packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+    queue_count++;
+    process_poll(consumer_process);
+
+    return NETSTACK_IP_PROCESS;
+}
+
+static enum netstack_ip_action ip_output(const linkaddr_t *localdest)
+{
+    if (localdest == NULL || linkaddr_cmp(localdest, &linkaddr_null))
+    {
+        multicasts++;
+    }
+    return NETSTACK_IP_PROCESS;
+}
+
+static struct netstack_ip_packet_processor packet_processor = {
+    .process_input = ip_input,
+    .process_output = ip_output
+};
+
+void link_evidence_init(struct process *consumer)
+{
+    consumer_process = consumer;
+    netstack_ip_packet_processor_add(&packet_processor);
+}
+
+int link_evidence_next(link_evidence_t *evidence)
+{
+    if (queue_count == 0)
+    {
+        return 0;
+    }
+    memcpy(evidence, &queue[queue_head], sizeof(*evidence));
+    queue_head = (queue_head + 1) % LINK_EVIDENCE_QUEUE_SIZE;
+    queue_count--;
+
+    if (queue_count == 0 && dropped > 0)
+    {
+        LOG_WARN("Dropped %u frames while the queue was full\n", dropped);
+        dropped = 0;
+    }
+    return 1;
+}
+
+int link_evidence_address(const linkaddr_t *lladdr, uip_ipaddr_t *ipaddr)
+{
+    uip_ds6_addr_t *global = uip_ds6_get_global(ADDR_PREFERRED);
+
+    if (global == NULL)
+    {
+        return 0;
+    }
+    uip_ipaddr_copy(ipaddr, &global->ipaddr);
+    uip_ds6_set_addr_iid(ipaddr, (const uip_lladdr_t *)lladdr);
+    return 1;
+}
+
+uint16_t link_evidence_multicasts(void)
+{
+    return multicasts;
+}
+
+uint16_t link_evidence_acks(const linkaddr_t *lladdr)
+{
+#if LINK_STATS_CONF_PACKET_COUNTERS
+    const struct link_stats *stats = link_stats_from_lladdr(lladdr);
+
+    if (stats != NULL)
+    {
+        // The current counters are folded into the totals periodically
+        return (uint16_t)(stats->cnt_total.num_packets_acked + stats->cnt_current.num_packets_acked);
+    }
+#endif
+    return 0;
+}
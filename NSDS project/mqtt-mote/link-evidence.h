@@ -0,0 +1,39 @@
+#ifndef LINK_EVIDENCE_H_
+#define LINK_EVIDENCE_H_
+
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+#include "net/linkaddr.h"
+
+// Number of received frames that can wait for the contact engine
+#ifndef LINK_EVIDENCE_CONF_QUEUE_SIZE
+#define LINK_EVIDENCE_QUEUE_SIZE 8
+#else
+#define LINK_EVIDENCE_QUEUE_SIZE LINK_EVIDENCE_CONF_QUEUE_SIZE
+#endif
+
+// A frame heard from a one-hop neighbour, whatever it carried (RPL, ND, data)
+typedef struct link_evidence
+{
+    uip_ipaddr_t ipaddr; // Global address of the neighbour: own prefix, its link-layer IID
+    int16_t rssi;
+    uint8_t lqi;
+} link_evidence_t;
+
+// Starts watching the IP traffic; the consumer is polled when frames are queued
+void link_evidence_init(struct process *consumer);
+
+// Pops the oldest queued frame. Returns 0 when the queue is empty.
+int link_evidence_next(link_evidence_t *evidence);
+
+// Builds the global address of a neighbour from its link-layer address.
+// Returns 0 while this node has no global address.
+int link_evidence_address(const linkaddr_t *lladdr, uip_ipaddr_t *ipaddr);
+
+// Number of multicasts sent so far (DIOs, ND), which every neighbour in range hears
+uint16_t link_evidence_multicasts(void);
+
+// Number of our frames the neighbour acknowledged so far, 0 without link-stats counters
+uint16_t link_evidence_acks(const linkaddr_t *lladdr);
+
+#endif /* LINK_EVIDENCE_H_ */
@@ -1,17 +1,28 @@
 #include "contiki.h"
 #include "random.h"
 #include "string.h"
-#include "lib/list.h"
-#include "lib/memb.h"
 
 #include "net/routing/routing.h"
 #include "net/netstack.h"
 #include "net/ipv6/simple-udp.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uipbuf.h"
+
+#include "contact-engine.h"
+#include "wake-window.h"
 
 #include "uip-ds6-nbr.h"
 #include "nbr-table.h"
 
+#if UPLINK_CONF_UDP
+#include "udp-uplink.h"
+#else
 #include "mqtt.h"
+#include "notify.h"
+#endif
+#if CONTACT_CONF_LINK_EVIDENCE
+#include "link-evidence.h"
+#endif
 #include "rpl.h"
 #include "net/ipv6/uip.h"
 #include "net/ipv6/sicslowpan.h"
@@ -24,12 +35,13 @@
 
 #define UDP_PORT 5555
 #define COMMUNICATION_LAG (CLOCK_SECOND >> 1)
-#define SEND_INTERVAL (CLOCK_SECOND * 20)
+#define SEND_INTERVAL (CLOCK_SECOND * CONTACT_CONF_SEND_INTERVAL)
 static const uip_ipaddr_t *my_ipaddr;
 
 #define MQTT_BROKER_IP_ADDR "fd00::1"
 #define MQTT_PUB_TOPIC_CONTACTS "nsds_gm/contacts/"
-static const char *broker_ip = MQTT_BROKER_IP_ADDR;
+#define MQTT_PUB_TOPIC_SIGNALS "nsds_gm/signals/"
+#define MQTT_SUB_TOPIC "nsds_gm/notify/"
 
 #define DEFAULT_ORG_ID "mqtt-client"
 #define DEFAULT_TYPE_ID "native"
@@ -40,21 +52,27 @@ static const char *broker_ip = MQTT_BROKER_IP_ADDR;
 #define DEFAULT_KEEP_ALIVE_TIMER 10
 
 #define NET_CONNECT_PERIODIC (CLOCK_SECOND >> 2)
-#define NET_RETRY (CLOCK_SECOND * 10)
+#define NET_RETRY_MAX (CLOCK_SECOND * 60)
+#define NET_JOIN_POLL_SHIFT_MAX 4
+
+// Connection health, from 0 (every recent delivery failed) to LINK_HEALTH_MAX
+#define LINK_HEALTH_MAX 100
 
 #define MAX_TCP_SEGMENT_SIZE 32
 #define ADDRESS_SIZE 32
 #define BUFFER_SIZE 128
-#define APP_BUFFER_SIZE 256
-#define MAX_CONTACTS 128
-#define CONTACT_TIMEOUT (CLOCK_SECOND * 30)
+
+// Report buffer, set by the build profile (see project-conf.h)
+#define APP_BUFFER_SIZE CONTACT_CONF_APP_BUFFER_SIZE
+
+#if UPLINK_CONF_UDP && UPLINK_MAX_PAYLOAD < APP_BUFFER_SIZE
+#error "Group reports do not fit the UDP uplink, set UPLINK_CONF_MAX_PAYLOAD with CONTACT_CONF_APP_BUFFER_SIZE"
+#endif
 
 #define STATE_MACHINE_PERIODIC (CLOCK_SECOND * 1)
+#define ACTIVITY_CHECK_INTERVAL (CLOCK_SECOND * 30)
 #define RECONNECT_INTERVAL (CLOCK_SECOND * 2)
 #define CONNECTION_STABLE_TIME (CLOCK_SECOND * 5)
-static struct timer connection_life;
-static uint8_t connect_attempt;
-static uint8_t state;
 #define STATE_INIT 0
 #define STATE_REGISTERED 1
 #define STATE_CONNECTING 2
@@ -69,19 +87,6 @@ static uint8_t state;
 #define CONFIG_AUTH_TOKEN_LEN 32
 #define CONFIG_CMD_TYPE_LEN 8
 #define CONFIG_IP_ADDR_STR_LEN 64
-#define DEFAULT_TYPE_ID "native"
-#define DEFAULT_AUTH_TOKEN "AUTHZ"
-#define DEFAULT_SUBSCRIBE_CMD_TYPE "+"
-#define DEFAULT_BROKER_PORT 1883
-#define DEFAULT_PUBLISH_INTERVAL (CLOCK_SECOND * 5)
-#define DEFAULT_KEEP_ALIVE_TIMER 10
-#define NET_CONNECT_PERIODIC (CLOCK_SECOND >> 2)
-#define NET_RETRY (CLOCK_SECOND * 10)
-#define MAX_TCP_SEGMENT_SIZE 32
-#define ADDRESS_SIZE 32
-#define BUFFER_SIZE 128
-#define APP_BUFFER_SIZE 256
-#define CONTACT_INACTIVITY_THRESHOLD (CLOCK_SECOND * 60)
 
 // Process declarations
 PROCESS(udp_client_process, "UDP client");
@@ -112,211 +117,142 @@ typedef struct mqtt_client_config
     uint16_t broker_port;
 } mqtt_client_config_t;
 
+static char app_buffer[APP_BUFFER_SIZE];
+static char *buf_ptr;
+
+// Sequence number of the next report, so the backend can drop the copies a
+// QoS 1 redelivery makes and put reports back in order. It starts at random,
+// so a rebooted mote is not taken for a stale one.
+static uint16_t report_seq;
+
+// MQTT client state, not needed when events go over the UDP uplink
+#if !UPLINK_CONF_UDP
+static const char *broker_ip = MQTT_BROKER_IP_ADDR;
 static struct mqtt_connection conn;
 static mqtt_client_config_t conf;
 
-static char app_buffer[APP_BUFFER_SIZE];
 static char client_id[BUFFER_SIZE];
 static char pub_topic_contacts[BUFFER_SIZE];
 static char pub_topic_signals[BUFFER_SIZE];
 static char sub_topic[BUFFER_SIZE];
-static char *buf_ptr;
 
 static struct mqtt_message *msg_ptr = 0;
 static struct etimer fsm_periodic_timer;
 
-// Data structures for contact management
-typedef struct mutual_contact
-{
-    struct mutual_contact *next;
-    uip_ipaddr_t ipaddr;
-} mutual_contact_t;
-
-typedef struct contact
-{
-    struct contact *next;
-    uip_ipaddr_t ipaddr;
-    clock_time_t last_seen;
-    clock_time_t last_activity;
-    LIST_STRUCT(mutual_contacts);
-} contact_t;
-
-// Memory blocks for contacts and mutual contacts
-
-MEMB(contacts_memb, contact_t, MAX_CONTACTS);
-MEMB(mutual_contacts_mem, mutual_contact_t, MAX_CONTACTS *MAX_CONTACTS);
-LIST(contacts_list);
-
-bool should_be_mutual_contact(contact_t *contact1, contact_t *contact2)
+// report_seq of the last publishes by MQTT message id, which the client hands
+// out in order, so that the PUBACK is logged with the seq of its report
+#define PUBLISHES_TRACKED 4
+static struct
 {
-    return (clock_time() - contact1->last_seen <= CONTACT_TIMEOUT) &&
-           (clock_time() - contact2->last_seen <= CONTACT_TIMEOUT);
-}
-
-// Function to check if a contact is inactive and remove it from the list
-static void check_contact_activity(void)
-{
-    contact_t *contact = list_head(contacts_list);
-    contact_t *next_contact;
+    uint16_t mid;
+    uint16_t seq;
+} publishes[PUBLISHES_TRACKED];
 
-    while (contact != NULL)
-    {
-        next_contact = list_item_next(contact); // Store next contact in case current one is removed
-
-        if (clock_time() - contact->last_activity > CONTACT_INACTIVITY_THRESHOLD)
-        {
-            LOG_INFO("Contact left: %s\n", trim_ip_addr(&contact->ipaddr));
-
-            char departure_message[APP_BUFFER_SIZE];
-            snprintf(departure_message, sizeof(departure_message),
-                     "{\"event\": \"departure\", \"ip\": \"%s\"}", trim_ip_addr(&contact->ipaddr));
-            mqtt_publish(&conn, NULL, pub_topic_contacts, (uint8_t *)departure_message,
-                         strlen(departure_message), MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF);
+static struct timer connection_life;
+static uint8_t connect_attempt;
+static uint8_t join_polls;
+static uint8_t state;
+#endif
 
-            list_remove(contacts_list, contact);
-            memb_free(&contacts_memb, contact);
-        }
+static uint8_t link_health = LINK_HEALTH_MAX;
 
-        contact = next_contact;
-    }
-}
+// Parameters the backend can push at runtime (see notify.h)
+static clock_time_t beacon_period = SEND_INTERVAL;
+#if !UPLINK_CONF_UDP
+static uint8_t current_group;
+#endif
 
-// Function to add a mutual contact to a contact's list
-void add_to_mutual_contacts_if_missing(contact_t *contact, const uip_ipaddr_t *addr)
-{
-    mutual_contact_t *mutual_contact = list_head(contact->mutual_contacts);
-    while (mutual_contact != NULL)
-    {
-        if (uip_ipaddr_cmp(&mutual_contact->ipaddr, addr))
-        {
-            return;
-        }
-        mutual_contact = list_item_next(mutual_contact);
-    }
-    mutual_contact = memb_alloc(&mutual_contacts_mem);
-    if (mutual_contact != NULL)
-    {
-        uip_ipaddr_copy(&mutual_contact->ipaddr, addr);
-        list_add(contact->mutual_contacts, mutual_contact);
-    }
-}
-static int count_potential_group_members(contact_t *c)
-{
-    if (c == NULL)
-    {
-        return 0;
-    }
-    return 1 + count_potential_group_members(list_item_next(c));
-}
+// Contacts of this mote (see contact-engine.h)
+static contact_engine_t contacts;
 
-static contact_t *update_contact_recursive(contact_t *c, const uip_ipaddr_t *addr, bool *found)
+// Function to move the connection health towards the outcome of a delivery:
+// a quarter of the way up on success, halfway down on failure
+static void link_health_update(uint8_t delivered)
 {
-    if (c == NULL)
+    if (delivered)
     {
-        return NULL;
+        link_health += (LINK_HEALTH_MAX - link_health + 3) / 4;
     }
-
-    if (uip_ipaddr_cmp(&c->ipaddr, addr))
+    else
     {
-        c->last_seen = clock_time();
-        LOG_INFO("Contact updated: %s\n", trim_ip_addr(addr));
-        *found = true;
-        return c;
+        link_health -= (link_health + 1) / 2;
     }
-
-    return update_contact_recursive(list_item_next(c), addr, found);
 }
 
-// Function to recursively update a contact's last seen time
-void update_mutual_contacts_recursive(contact_t *current_contact, contact_t *other_contacts)
+// Function to compute the beacon period from the connection health. Reports
+// cannot reach the backend while the uplink is failing, so a degraded mote
+// beacons up to half as often and leaves the channel to the reconnecting
+// motes. The period stays below the contact inactivity threshold.
+static clock_time_t beacon_interval(void)
 {
-    if (other_contacts == NULL)
-        return;
-
-    if (current_contact != other_contacts)
-    {
-        if (should_be_mutual_contact(current_contact, other_contacts))
-        {
-            add_to_mutual_contacts_if_missing(current_contact, &other_contacts->ipaddr);
-            add_to_mutual_contacts_if_missing(other_contacts, &current_contact->ipaddr);
-        }
-    }
-    update_mutual_contacts_recursive(current_contact, list_item_next(other_contacts));
+    return beacon_period + (beacon_period * (LINK_HEALTH_MAX - link_health)) / LINK_HEALTH_MAX;
 }
 
-// Function to recursively update mutual contacts
-void update_all_mutual_contacts(contact_t *contacts)
+// Function to tell whether app_buffer can take the next event. The MQTT client
+// sends the payload from the caller's buffer until the publish is out, so the
+// event in flight must not be overwritten; the UDP uplink copies it. Without a
+// connection nothing is in flight and the publish fails as a delivery would.
+static int uplink_ready(void)
 {
-    if (contacts == NULL)
-        return;
-    update_mutual_contacts_recursive(contacts, list_head(contacts_list));
-    update_all_mutual_contacts(list_item_next(contacts));
+#if UPLINK_CONF_UDP
+    return 1;
+#else
+    return !mqtt_connected(&conn) || (mqtt_ready(&conn) && conn.out_buffer_sent);
+#endif
 }
 
-// Function to recursively update mutual contacts
-static void update_contact(const uip_ipaddr_t *addr)
+// Function to send an event to the backend over the configured uplink. The
+// payload carries report_seq, which moves on once the event is accepted.
+static int publish_event(const char *payload)
 {
-    bool found = false;
-    update_contact_recursive(list_head(contacts_list), addr, &found);
-    contact_t *contact = list_head(contacts_list);
-
-    while (contact != NULL)
+#if UPLINK_CONF_UDP
+    if (!udp_uplink_send(payload, strlen(payload)))
     {
-        if (uip_ipaddr_cmp(&contact->ipaddr, addr))
-        {
-            contact->last_seen = clock_time();
-            contact->last_activity = clock_time();
-            found = true;
-            break;
-        }
-        contact = list_item_next(contact);
+        link_health_update(0);
+        return 0;
     }
-
-    if (!found)
-    {
-        contact = memb_alloc(&contacts_memb);
-        if (contact != NULL)
-        {
-            uip_ipaddr_copy(&contact->ipaddr, addr);
-            contact->last_seen = clock_time();
-            LIST_STRUCT_INIT(contact, mutual_contacts);
-            list_add(contacts_list, contact);
-        }
+    report_seq++;
+    return 1;
+#else
+    uint16_t mid;
+    mqtt_status_t status = mqtt_publish(&conn, &mid, pub_topic_contacts, (uint8_t *)payload,
+                                        strlen(payload), MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF);
+    if (status != MQTT_STATUS_OK)
+    {
+        LOG_ERR("Failed to publish event: status %d\n", status);
+        link_health_update(0);
+        return 0;
     }
-    update_all_mutual_contacts(list_head(contacts_list));
+    LOG_INFO("Uplink event seq=%u mid=%u\n", report_seq, mid);
+    publishes[mid % PUBLISHES_TRACKED].mid = mid;
+    publishes[mid % PUBLISHES_TRACKED].seq = report_seq;
+    report_seq++;
+    return 1;
+#endif
 }
 
-// Function to recursively check if a group is formed
-bool is_group_formed(contact_t *contact, int *member_count)
+// Function to tell the backend that a contact left
+static void report_departure(contact_engine_t *engine, const contact_t *contact)
 {
-    if (contact == NULL)
-    {
-        return true;
-    }
-
-    int mutual_count = 0;
-    mutual_contact_t *mutual_contact = list_head(contact->mutual_contacts);
-    while (mutual_contact != NULL)
-    {
-        mutual_count++;
-        mutual_contact = list_item_next(mutual_contact);
-    }
+    LOG_INFO("Contact left: %s\n", trim_ip_addr(&contact->ipaddr));
 
-    if (mutual_count < 2)
+    if (!uplink_ready())
     {
-        return false;
+        LOG_WARN("Uplink busy, departure not reported\n");
+        return;
     }
-
-    *member_count += 1;
-
-    return is_group_formed(list_item_next(contact), member_count);
+    // The MQTT client sends from the caller's buffer, so it must outlive this call
+    snprintf(app_buffer, sizeof(app_buffer),
+             "{\"seq\": %u, \"event\": \"departure\", \"ip\": \"%s\"}",
+             report_seq, trim_ip_addr(&contact->ipaddr));
+    publish_event(app_buffer);
 }
 
 // Function to recursively count mutual contactsa
 static void check_group_formation()
 {
-    int member_count = count_potential_group_members(list_head(contacts_list));
-    if (member_count >= 3)
+    int member_count = contact_engine_in_proximity(&contacts);
+    if (member_count >= CONTACT_GROUP_MIN_SIZE)
     {
         report_group_formation();
     }
@@ -347,10 +283,13 @@ static void add_ip_to_json_array_recursive(contact_t *c, char *json_array, size_
         strcat(json_array, "]");
         return;
     }
-    char ip_str[ADDRESS_SIZE];
-    snprintf(ip_str, ADDRESS_SIZE, "%s", trim_ip_addr(&c->ipaddr));
-    add_ip_to_json_array(json_array, ip_str, max_len);
-    add_ip_to_json_array_recursive(list_item_next(c), json_array, max_len);
+    if (c->in_proximity)
+    {
+        char ip_str[ADDRESS_SIZE];
+        snprintf(ip_str, ADDRESS_SIZE, "%s", trim_ip_addr(&c->ipaddr));
+        add_ip_to_json_array(json_array, ip_str, max_len);
+    }
+    add_ip_to_json_array_recursive(contact_engine_next(&contacts, c), json_array, max_len);
 }
 
 // Function to report group formation to the backend
@@ -358,42 +297,41 @@ void report_group_formation()
 {
     int len;
     int remaining = APP_BUFFER_SIZE;
-    static char pub_topic[BUFFER_SIZE];
 
+    // Reported again on the next check
+    if (!uplink_ready())
+    {
+        LOG_WARN("Uplink busy, group formation not reported\n");
+        return;
+    }
     buf_ptr = app_buffer;
 
     LOG_INFO("Reporting group formation.\n");
-    char json_array[APP_BUFFER_SIZE] = {'[', '\0'};
-    add_ip_to_json_array_recursive(list_head(contacts_list), json_array, sizeof(json_array));
-    //strcat(json_array, "]");
-
-    char message[APP_BUFFER_SIZE];
-    snprintf(message, sizeof(message), "{\"group\": true, \"members\": %s}", json_array);
-
-    //char message[APP_BUFFER_SIZE];
-    len = snprintf(buf_ptr, remaining, "{\"group\": true, \"members\": %s}", json_array);
+    // The members array stays last, the backend scans for it from the start
+    len = snprintf(buf_ptr, remaining, "{\"seq\": %u, \"group\": true, \"members\": [", report_seq);
     if(len < 0 || len >= remaining) {
         LOG_ERR("Buffer too short. Have %d, need %d + \\0\n", remaining, len);
         return;
     }
-    remaining -= len;
-    buf_ptr += len;
+    // The array is built in place from its '[', leaving room for "]}"
+    buf_ptr += len - 1;
+    remaining -= len - 1;
+    add_ip_to_json_array_recursive(contact_engine_next(&contacts, NULL), buf_ptr, remaining - 2);
+    strcat(buf_ptr, "}");
 
-    strcpy(pub_topic, pub_topic_contacts);
-
-    mqtt_status_t status = mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer, strlen(app_buffer), MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF);
-    if (status == MQTT_STATUS_OK || status == MQTT_STATUS_OUT_QUEUE_FULL)
+    if (publish_event(app_buffer))
     {
-        LOG_INFO("Group formation reported: %s\n", message);
+        LOG_INFO("Group formation reported: %s\n", app_buffer);
     }
     else
     {
-        LOG_ERR("Failed to report group formation: status %d\n", status);
+        LOG_ERR("Failed to report group formation\n");
     }
 }
 
 /*---------------------------------------------------------------------------*/
 // MQTT functions
+#if !UPLINK_CONF_UDP
 static int construct_pub_topics(void)
 {
     int len;
@@ -518,10 +456,35 @@ static void update_config(void)
     }
     return;
 }
+// Function to randomize a delay over its upper half
+static clock_time_t jitter(clock_time_t delay)
+{
+    return delay / 2 + random_rand() % (delay / 2 + 1);
+}
+
+// Function to compute the delay before the next connection attempt. It doubles
+// with every failed attempt up to NET_RETRY_MAX and is randomized, so motes
+// that lost the broker at the same time do not all come back at the same time.
+static clock_time_t reconnect_delay(void)
+{
+    clock_time_t delay = NET_RETRY_MAX;
+    uint8_t shift = connect_attempt > 0 ? connect_attempt - 1 : 0;
+
+    if (shift < 8 && (RECONNECT_INTERVAL << shift) < NET_RETRY_MAX)
+    {
+        delay = RECONNECT_INTERVAL << shift;
+    }
+    return jitter(delay);
+}
+
 static void connect_to_broker(void)
 {
     // Connect to MQTT server
+#if POWER_CONF_LOW
+    mqtt_connect(&conn, conf.broker_ip, conf.broker_port, WAKE_WINDOW_CONF_KEEP_ALIVE);
+#else
     mqtt_connect(&conn, conf.broker_ip, conf.broker_port, conf.pub_interval * 3);
+#endif
     state = STATE_CONNECTING;
 }
 static void subscribe(void)
@@ -536,6 +499,46 @@ static void subscribe(void)
         LOG_INFO("Tried to subscribe but command queue was full!\n");
     }
 }
+// Function to apply a notification pushed by the backend
+static void apply_notification(const uint8_t *payload, uint16_t len)
+{
+    notify_msg_t notify;
+
+    if (len < sizeof(notify) || payload[0] != NOTIFY_VERSION)
+    {
+        LOG_WARN("Ignoring notification of %u bytes\n", len);
+        return;
+    }
+    memcpy(&notify, payload, sizeof(notify));
+
+    current_group = notify.group;
+    if (notify.beacon_interval == NOTIFY_COMPILED_DEFAULT)
+    {
+        beacon_period = SEND_INTERVAL;
+    }
+    else if (notify.beacon_interval >= NOTIFY_BEACON_MIN && notify.beacon_interval <= NOTIFY_BEACON_MAX)
+    {
+        beacon_period = notify.beacon_interval * CLOCK_SECOND;
+    }
+    if (notify.contact_timeout == NOTIFY_COMPILED_DEFAULT)
+    {
+        contacts.inactivity_threshold = CONTACT_INACTIVITY_THRESHOLD;
+    }
+    else if (notify.contact_timeout > 0)
+    {
+        contacts.inactivity_threshold = notify.contact_timeout * CLOCK_SECOND;
+    }
+    // A contact must survive the longest beacon period (twice the base, plus jitter)
+    if (contacts.inactivity_threshold < 3 * beacon_period)
+    {
+        contacts.inactivity_threshold = 3 * beacon_period;
+    }
+
+    LOG_INFO("Notification: group %u, beacon %lu s, contact timeout %lu s\n", current_group,
+             (unsigned long)(beacon_period / CLOCK_SECOND),
+             (unsigned long)(contacts.inactivity_threshold / CLOCK_SECOND));
+}
+
 static void mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
 {
     switch (event)
@@ -544,12 +547,14 @@ static void mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data
     {
         LOG_INFO("Connected to the MQTT broker!\n");
         timer_set(&connection_life, CONNECTION_STABLE_TIME);
+        link_health_update(1);
         state = STATE_CONNECTED;
         break;
     }
     case MQTT_EVENT_DISCONNECTED:
     {
         LOG_INFO("Disconnected from the MQTT broker: reason %u\n", *((mqtt_event_t *)data));
+        link_health_update(0);
 
         state = STATE_DISCONNECTED;
         process_poll(&mqtt_client_process);
@@ -560,7 +565,7 @@ static void mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data
         msg_ptr = data;
         if (msg_ptr->first_chunk)
         {
-            LOG_INFO("NOTIFICATION received from mote with ID #%i \n", msg_ptr->payload_length);
+            apply_notification(msg_ptr->payload_chunk, msg_ptr->payload_chunk_length);
         }
         break;
     }
@@ -577,7 +582,16 @@ static void mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data
     }
     case MQTT_EVENT_PUBACK:
     {
-        LOG_INFO("Publishing complete\n");
+        uint16_t mid = *((uint16_t *)data);
+        if (publishes[mid % PUBLISHES_TRACKED].mid == mid)
+        {
+            LOG_INFO("Uplink ack seq=%u mid=%u\n", publishes[mid % PUBLISHES_TRACKED].seq, mid);
+        }
+        else
+        {
+            LOG_INFO("Uplink ack mid=%u\n", mid);
+        }
+        link_health_update(1);
         break;
     }
     default:
@@ -596,6 +610,7 @@ static void state_machine(void)
 
         conn.auto_reconnect = 0;
         connect_attempt = 1;
+        join_polls = 0;
 
         state = STATE_REGISTERED;
     case STATE_REGISTERED:
@@ -604,8 +619,16 @@ static void state_machine(void)
             update_config();
             LOG_INFO("Joined network! Connect attempt %u\n", connect_attempt);
             connect_to_broker();
+            join_polls = 0;
+            etimer_set(&fsm_periodic_timer, NET_CONNECT_PERIODIC);
+            return;
+        }
+        // Not joined yet: poll less and less often, up to 16 times NET_CONNECT_PERIODIC
+        etimer_set(&fsm_periodic_timer, wake_window_delay(jitter(NET_CONNECT_PERIODIC << join_polls)));
+        if (join_polls < NET_JOIN_POLL_SHIFT_MAX)
+        {
+            join_polls++;
         }
-        etimer_set(&fsm_periodic_timer, NET_CONNECT_PERIODIC);
         return;
         break;
     case STATE_CONNECTING:
@@ -624,10 +647,16 @@ static void state_machine(void)
         break;
     case STATE_DISCONNECTED:
         mqtt_disconnect(&conn);
-        connect_attempt++;
+        if (connect_attempt < 0xFF)
+        {
+            connect_attempt++;
+        }
 
-        LOG_INFO("Disconnected: attempt %u in %lu ticks\n", connect_attempt, NET_RETRY);
-        etimer_set(&fsm_periodic_timer, NET_RETRY);
+        {
+            clock_time_t delay = reconnect_delay();
+            LOG_INFO("Disconnected: attempt %u in %lu ticks\n", connect_attempt, (unsigned long)delay);
+            etimer_set(&fsm_periodic_timer, wake_window_delay(delay));
+        }
 
         state = STATE_REGISTERED;
         return;
@@ -639,8 +668,11 @@ static void state_machine(void)
         return;
     }
 
-    etimer_set(&fsm_periodic_timer, STATE_MACHINE_PERIODIC);
+    // Once subscribed there is nothing to wait for, the next check can wait for a wake window
+    etimer_set(&fsm_periodic_timer,
+               state == STATE_SUBSCRIBED ? wake_window_delay(STATE_MACHINE_PERIODIC) : STATE_MACHINE_PERIODIC);
 }
+#endif /* !UPLINK_CONF_UDP */
 
 // UDP callback function
 static void udp_rx_callback(struct simple_udp_connection *c,
@@ -649,17 +681,86 @@ static void udp_rx_callback(struct simple_udp_connection *c,
                             const uint8_t *data, uint16_t datalen)
 {
     LOG_INFO("UDP callback received from %s\n", trim_ip_addr(sender_addr));
-    if (uip_ipaddr_cmp(&sender_addr, &receiver_addr))
+    if (uip_ipaddr_cmp(sender_addr, receiver_addr))
         return;
 
-    // Update or add the sender as a contact
-    update_contact(sender_addr);
+#if !CONTACT_LINK_EVIDENCE
+    // Update or add the sender as a contact, weighted by the signal of this beacon
+    contact_t *contact = contact_engine_heard(&contacts, sender_addr, (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI),
+                                              (uint8_t)packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY), clock_time());
+    if (contact != NULL && contact->in_proximity)
+    {
+        LOG_INFO("Contact updated: %s\n", trim_ip_addr(sender_addr));
+    }
 
     // Check if a group can be formed with the updated contacts list
     check_group_formation();
+#endif
+    // With link evidence the beacon already reached the contact engine like any other frame
+}
+
+#if CONTACT_LINK_EVIDENCE
+static struct timer report_timer;
+
+// Function to feed the frames heard from the neighbours to the contact engine
+static void handle_link_evidence(void)
+{
+    link_evidence_t evidence;
+    uip_ipaddr_t root_ipaddr;
+    int has_root = NETSTACK_ROUTING.get_root_ipaddr(&root_ipaddr);
+
+    while (link_evidence_next(&evidence))
+    {
+        // The border router does not take part in groups
+        if (!has_root || !uip_ipaddr_cmp(&evidence.ipaddr, &root_ipaddr))
+        {
+            contact_engine_heard(&contacts, &evidence.ipaddr, evidence.rssi, evidence.lqi, clock_time());
+        }
+    }
+
+    // Frames arrive far more often than beacons: report changes at once and
+    // otherwise refresh the report once per beacon period
+    if (contacts.changed || timer_expired(&report_timer))
+    {
+        contacts.changed = 0;
+        timer_set(&report_timer, beacon_interval());
+        check_group_formation();
+    }
+}
+
+// Function to tell whether a neighbour heard us since the last beacon round,
+// through a multicast of ours or an acknowledged frame
+static int neighbour_heard_us(const uip_ds6_nbr_t *nbr, int heard_multicast)
+{
+    const linkaddr_t *lladdr = (const linkaddr_t *)uip_ds6_nbr_get_ll(nbr);
+    uip_ipaddr_t ipaddr;
+    contact_t *contact;
+    uint16_t acks;
+
+    if (heard_multicast)
+    {
+        return 1;
+    }
+    if (lladdr == NULL || !link_evidence_address(lladdr, &ipaddr))
+    {
+        return 0;
+    }
+    contact = contact_engine_find(&contacts, &ipaddr);
+    if (contact == NULL)
+    {
+        return 0;
+    }
 
-    
+    acks = link_evidence_acks(lladdr);
+    if (acks != contact->acks)
+    {
+        contact->acks = acks;
+        contact->last_activity = clock_time();
+        return 1;
+    }
+    return 0;
 }
+#endif
 
 /*---------------------------------------------------------------------------*
                             UDP CLIENT PROCESS
@@ -670,17 +771,30 @@ PROCESS_THREAD(udp_client_process, ev, data)
     static struct etimer udp_lag_timer;
     static uip_ds6_nbr_t *nbr;
     static uip_ipaddr_t *send_to_ipaddr;
+#if CONTACT_LINK_EVIDENCE
+    static uint16_t multicast_mark;
+    static uint8_t heard_multicast;
+    static uint16_t beacons_sent;
+    static uint16_t beacons_implicit;
+#endif
 
     PROCESS_BEGIN();
 
     // Initialize UDP connection
     simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_rx_callback);
+#if CONTACT_LINK_EVIDENCE
+    link_evidence_init(&udp_client_process);
+    timer_set(&report_timer, SEND_INTERVAL);
+#endif
 
     // Get one of this node's global addresses.
     my_ipaddr = rpl_get_global_address();
 
+    // First process to start, every periodic timer of the mote follows its windows
+    wake_window_init();
+
     // Starting udp communication periodic timer
-    etimer_set(&udp_find_timer, random_rand() % SEND_INTERVAL);
+    etimer_set(&udp_find_timer, wake_window_delay(random_rand() % SEND_INTERVAL));
     while (1)
     {
         PROCESS_WAIT_EVENT();
@@ -689,14 +803,41 @@ PROCESS_THREAD(udp_client_process, ev, data)
             // Point to the head of the neighbors list
             nbr = nbr_table_head(ds6_neighbors);
             etimer_set(&udp_lag_timer, COMMUNICATION_LAG);
+#if CONTACT_LINK_EVIDENCE
+            heard_multicast = link_evidence_multicasts() != multicast_mark;
+            multicast_mark = link_evidence_multicasts();
+            beacons_sent = 0;
+            beacons_implicit = 0;
+#endif
         }
+#if CONTACT_LINK_EVIDENCE
+        else if (ev == PROCESS_EVENT_POLL)
+        {
+            handle_link_evidence();
+        }
+#endif
         else if (ev == PROCESS_EVENT_TIMER && data == &udp_lag_timer)
         {
             if (nbr != NULL)
             {
-                send_to_ipaddr = &(nbr->ipaddr);
-                uint8_t isSignal = 0;
-                simple_udp_sendto(&udp_conn, &isSignal, sizeof(isSignal), send_to_ipaddr);
+#if CONTACT_LINK_EVIDENCE
+                // Beacon only the neighbours that may not have heard us otherwise
+                if (neighbour_heard_us(nbr, heard_multicast))
+                {
+                    beacons_implicit++;
+                }
+                else
+#endif
+                {
+                    send_to_ipaddr = &(nbr->ipaddr);
+                    uint8_t isSignal = 0;
+                    // A lost beacon is replaced by the next one, retrying only adds contention
+                    uipbuf_set_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS, CONTACT_BEACON_MAX_TX);
+                    simple_udp_sendto(&udp_conn, &isSignal, sizeof(isSignal), send_to_ipaddr);
+#if CONTACT_LINK_EVIDENCE
+                    beacons_sent++;
+#endif
+                }
 
                 // Move pointer down the table stack
                 nbr = nbr_table_next(ds6_neighbors, nbr);
@@ -704,7 +845,11 @@ PROCESS_THREAD(udp_client_process, ev, data)
             }
             else
             {
-                etimer_set(&udp_find_timer, SEND_INTERVAL - (5 * CLOCK_SECOND) + (random_rand() % (10 * CLOCK_SECOND)));
+#if CONTACT_LINK_EVIDENCE
+                LOG_INFO("Beacon round: %u sent, %u implicit\n", beacons_sent, beacons_implicit);
+#endif
+                etimer_set(&udp_find_timer,
+                           wake_window_delay(contact_engine_round_delay(beacon_interval(), random_rand())));
             }
         }
     }
@@ -722,14 +867,17 @@ PROCESS_THREAD(mqtt_client_process, ev, data)
     PROCESS_BEGIN();
 
     // Initialize the contact list and memory block
-    list_init(contacts_list);
-    memb_init(&contacts_memb);
-    memb_init(&mutual_contacts_mem);
+    contact_engine_init(&contacts, report_departure);
+    report_seq = random_rand();
 
+#if UPLINK_CONF_UDP
+    udp_uplink_init(link_health_update);
+#else
     init_config();
+#endif
 
     // Initialize and start the activity check timer
-    etimer_set(&activity_check_timer, CLOCK_SECOND * 30); // Check activity every 30 seconds
+    etimer_set(&activity_check_timer, wake_window_delay(ACTIVITY_CHECK_INTERVAL));
 
     while (1)
     {
@@ -737,14 +885,21 @@ PROCESS_THREAD(mqtt_client_process, ev, data)
 
         if (ev == PROCESS_EVENT_TIMER)
         {
+#if !UPLINK_CONF_UDP
             if (data == &fsm_periodic_timer)
             {
                 state_machine();
             }
-            else if (data == &activity_check_timer)
+            else
+#endif
+            if (data == &activity_check_timer)
             {
-                check_contact_activity();
+                contact_engine_expire(&contacts, clock_time());
+#if POWER_CONF_LOW
+                etimer_set(&activity_check_timer, wake_window_delay(ACTIVITY_CHECK_INTERVAL));
+#else
                 etimer_reset(&activity_check_timer); // Reset timer for next check
+#endif
             }
         }
     }
@@ -32,11 +32,114 @@
 #ifndef PROJECT_CONF_H_
 #define PROJECT_CONF_H_
 /*---------------------------------------------------------------------------*/
+/* Report events over the lightweight UDP uplink instead of MQTT */
+#ifndef UPLINK_CONF_UDP
+#define UPLINK_CONF_UDP 0
+#endif
+//*---------------------------------------------------------------------------*/
 /* Enable TCP */
+#if !UPLINK_CONF_UDP
 #define UIP_CONF_TCP 1
+#endif
 //*---------------------------------------------------------------------------*/
 #define IEEE802154_CONF_DEFAULT_CHANNEL      21
 //*---------------------------------------------------------------------------*/
+/* Contact engine profile, selected with PROFILE=tiny|standard|dense in the
+ * Makefile. It sizes the contact pool, its mutual-contact bitsets and the
+ * report buffer, and picks the contact lookup: a list scan for the small
+ * pools, a hash index over the interface identifier for the dense one.
+ * Dense motes hear more neighbours, so they beacon less often and keep
+ * contacts longer. Every CONTACT_CONF_* value can still be overridden. */
+#define CONTACT_PROFILE_TINY     1
+#define CONTACT_PROFILE_STANDARD 2
+#define CONTACT_PROFILE_DENSE    3
+
+#ifndef CONTACT_CONF_PROFILE
+#define CONTACT_CONF_PROFILE CONTACT_PROFILE_STANDARD
+#endif
+
+#if CONTACT_CONF_PROFILE == CONTACT_PROFILE_TINY
+#define CONTACT_PROFILE_MAX_CONTACTS         16
+#define CONTACT_PROFILE_APP_BUFFER_SIZE      256
+#define CONTACT_PROFILE_SEND_INTERVAL        20 /* s */
+#define CONTACT_PROFILE_TIMEOUT              30 /* s */
+#define CONTACT_PROFILE_INACTIVITY_THRESHOLD 60 /* s */
+#define CONTACT_PROFILE_HASH_INDEX           0
+#elif CONTACT_CONF_PROFILE == CONTACT_PROFILE_DENSE
+#define CONTACT_PROFILE_MAX_CONTACTS         128
+#define CONTACT_PROFILE_APP_BUFFER_SIZE      1024
+#define CONTACT_PROFILE_SEND_INTERVAL        30 /* s */
+#define CONTACT_PROFILE_TIMEOUT              45 /* s */
+#define CONTACT_PROFILE_INACTIVITY_THRESHOLD 90 /* s */
+#define CONTACT_PROFILE_HASH_INDEX           1
+#else
+/* The limits of the motes before the profiles */
+#define CONTACT_PROFILE_MAX_CONTACTS         128
+#define CONTACT_PROFILE_APP_BUFFER_SIZE      256
+#define CONTACT_PROFILE_SEND_INTERVAL        20 /* s */
+#define CONTACT_PROFILE_TIMEOUT              30 /* s */
+#define CONTACT_PROFILE_INACTIVITY_THRESHOLD 60 /* s */
+#define CONTACT_PROFILE_HASH_INDEX           0
+#endif
+
+#ifndef CONTACT_CONF_MAX_CONTACTS
+#define CONTACT_CONF_MAX_CONTACTS CONTACT_PROFILE_MAX_CONTACTS
+#endif
+#ifndef CONTACT_CONF_APP_BUFFER_SIZE
+#define CONTACT_CONF_APP_BUFFER_SIZE CONTACT_PROFILE_APP_BUFFER_SIZE
+#endif
+#ifndef CONTACT_CONF_SEND_INTERVAL
+#define CONTACT_CONF_SEND_INTERVAL CONTACT_PROFILE_SEND_INTERVAL
+#endif
+#ifndef CONTACT_CONF_TIMEOUT
+#define CONTACT_CONF_TIMEOUT CONTACT_PROFILE_TIMEOUT
+#endif
+#ifndef CONTACT_CONF_INACTIVITY_THRESHOLD
+#define CONTACT_CONF_INACTIVITY_THRESHOLD CONTACT_PROFILE_INACTIVITY_THRESHOLD
+#endif
+#ifndef CONTACT_CONF_HASH_INDEX
+#define CONTACT_CONF_HASH_INDEX CONTACT_PROFILE_HASH_INDEX
+#endif
+/* A group report is a single UDP uplink event (common/uplink.h) */
+#ifndef UPLINK_CONF_MAX_PAYLOAD
+#define UPLINK_CONF_MAX_PAYLOAD CONTACT_CONF_APP_BUFFER_SIZE
+#endif
+//*---------------------------------------------------------------------------*/
+/* Proximity filter: a neighbour becomes a contact once the moving average of
+ * its beacon RSSI (dBm) and LQI reaches the ENTER thresholds, and stops being
+ * one when either falls below the LEAVE thresholds. With the Cooja UDGM and a
+ * 60 m range, -45/-55 dBm is about 38/44 m. LQI thresholds of 0 disable LQI. */
+#ifndef PROXIMITY_CONF_RSSI_ENTER
+#define PROXIMITY_CONF_RSSI_ENTER -45
+#endif
+#ifndef PROXIMITY_CONF_RSSI_LEAVE
+#define PROXIMITY_CONF_RSSI_LEAVE -55
+#endif
+#ifndef PROXIMITY_CONF_LQI_ENTER
+#define PROXIMITY_CONF_LQI_ENTER 0
+#endif
+#ifndef PROXIMITY_CONF_LQI_LEAVE
+#define PROXIMITY_CONF_LQI_LEAVE 0
+#endif
+/* Weight of a new sample in the averages: 1 / 2^SHIFT */
+#ifndef PROXIMITY_CONF_EWMA_SHIFT
+#define PROXIMITY_CONF_EWMA_SHIFT 2
+#endif
+//*---------------------------------------------------------------------------*/
+/* Link evidence: every frame heard from a neighbour (RPL, ND, data, beacons)
+ * counts as proximity evidence, and a neighbour is only beaconed when it may
+ * not have heard us through a multicast or an acknowledged frame. */
+#ifndef CONTACT_CONF_LINK_EVIDENCE
+#define CONTACT_CONF_LINK_EVIDENCE 0
+#endif
+#if CONTACT_CONF_LINK_EVIDENCE
+/* Acknowledgement counters per neighbour */
+#define LINK_STATS_CONF_PACKET_COUNTERS 1
+#endif
+//*---------------------------------------------------------------------------*/
+/* TSCH and Orchestra schedule (make MAC=tsch) */
+#include "tsch-schedule.h"
+//*---------------------------------------------------------------------------*/
 #define NATIVE_TEMPERATURE 25
 //*---------------------------------------------------------------------------*/
 #endif /* PROJECT_CONF_H_ */
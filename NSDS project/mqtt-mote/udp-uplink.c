@@ -0,0 +1,160 @@
+#include "contiki.h"
+#include "random.h"
+#include "string.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+#include "net/routing/routing.h"
+#include "net/ipv6/simple-udp.h"
+#include "net/ipv6/uip.h"
+#include "sys/ctimer.h"
+
+#include "udp-uplink.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "Uplink"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Event waiting to be acknowledged by the border router
+typedef struct uplink_event
+{
+    struct uplink_event *next;
+    uint16_t seq;
+    uint8_t retries;
+    uint16_t len;
+    uint8_t data[sizeof(uplink_hdr_t) + UPLINK_MAX_PAYLOAD];
+} uplink_event_t;
+
+MEMB(uplink_events_memb, uplink_event_t, UDP_UPLINK_QUEUE_SIZE);
+LIST(uplink_events_list);
+
+static struct simple_udp_connection uplink_conn;
+static struct ctimer retransmit_timer;
+static uint16_t next_seq;
+static udp_uplink_callback_t delivery_callback;
+
+static void retransmit_callback(void *ptr);
+
+// Sends the head of the queue; only one event is in flight at a time
+static void transmit_head(void)
+{
+    uip_ipaddr_t root_ipaddr;
+    uplink_event_t *event = list_head(uplink_events_list);
+
+    if (event == NULL)
+    {
+        return;
+    }
+
+    if (NETSTACK_ROUTING.node_is_reachable() && NETSTACK_ROUTING.get_root_ipaddr(&root_ipaddr))
+    {
+        simple_udp_sendto(&uplink_conn, event->data, event->len, &root_ipaddr);
+    }
+
+    // Exponential backoff on every retransmission
+    ctimer_set(&retransmit_timer, UDP_UPLINK_ACK_TIMEOUT << event->retries, retransmit_callback, NULL);
+}
+
+static void retransmit_callback(void *ptr)
+{
+    uplink_event_t *event = list_head(uplink_events_list);
+
+    if (event == NULL)
+    {
+        return;
+    }
+
+    if (event->retries >= UDP_UPLINK_MAX_RETRIES)
+    {
+        LOG_WARN("Uplink drop seq=%u after %u retries\n", event->seq, event->retries);
+        list_remove(uplink_events_list, event);
+        memb_free(&uplink_events_memb, event);
+        if (delivery_callback != NULL)
+        {
+            delivery_callback(0);
+        }
+    }
+    else
+    {
+        event->retries++;
+    }
+    transmit_head();
+}
+
+static void uplink_rx_callback(struct simple_udp_connection *c,
+                               const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+                               const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+                               const uint8_t *data, uint16_t datalen)
+{
+    uplink_hdr_t hdr;
+    uplink_event_t *event = list_head(uplink_events_list);
+
+    if (datalen < sizeof(uplink_hdr_t) || event == NULL)
+    {
+        return;
+    }
+
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.type != UPLINK_MSG_ACK || UIP_NTOHS(hdr.seq) != event->seq)
+    {
+        return;
+    }
+
+    LOG_INFO("Uplink ack seq=%u\n", event->seq);
+    ctimer_stop(&retransmit_timer);
+    list_remove(uplink_events_list, event);
+    memb_free(&uplink_events_memb, event);
+    if (delivery_callback != NULL)
+    {
+        delivery_callback(1);
+    }
+    transmit_head();
+}
+
+void udp_uplink_init(udp_uplink_callback_t callback)
+{
+    delivery_callback = callback;
+    memb_init(&uplink_events_memb);
+    list_init(uplink_events_list);
+    next_seq = random_rand();
+    simple_udp_register(&uplink_conn, UPLINK_UDP_PORT, NULL, UPLINK_UDP_PORT, uplink_rx_callback);
+}
+
+int udp_uplink_send(const char *payload, uint16_t len)
+{
+    uplink_hdr_t hdr;
+    uplink_event_t *event;
+
+    if (len > UPLINK_MAX_PAYLOAD)
+    {
+        LOG_ERR("Uplink payload too long: %u\n", len);
+        return 0;
+    }
+
+    event = memb_alloc(&uplink_events_memb);
+    if (event == NULL)
+    {
+        LOG_WARN("Uplink queue full\n");
+        return 0;
+    }
+
+    event->seq = next_seq++;
+    event->retries = 0;
+    event->len = sizeof(hdr) + len;
+
+    hdr.type = UPLINK_MSG_EVENT;
+    hdr.flags = 0;
+    hdr.seq = UIP_HTONS(event->seq);
+    memcpy(event->data, &hdr, sizeof(hdr));
+    memcpy(event->data + sizeof(hdr), payload, len);
+
+    list_add(uplink_events_list, event);
+    LOG_INFO("Uplink event seq=%u\n", event->seq);
+
+    // Start transmitting if nothing else is waiting for an ACK
+    if (list_head(uplink_events_list) == event)
+    {
+        transmit_head();
+    }
+    return 1;
+}
@@ -0,0 +1,26 @@
+#ifndef UDP_UPLINK_H_
+#define UDP_UPLINK_H_
+
+#include "contiki.h"
+#include "uplink.h"
+
+// Number of events that can wait for an acknowledgement from the root
+#ifndef UDP_UPLINK_CONF_QUEUE_SIZE
+#define UDP_UPLINK_QUEUE_SIZE 4
+#else
+#define UDP_UPLINK_QUEUE_SIZE UDP_UPLINK_CONF_QUEUE_SIZE
+#endif
+
+#define UDP_UPLINK_ACK_TIMEOUT (CLOCK_SECOND * 2)
+#define UDP_UPLINK_MAX_RETRIES 4
+
+// Called with 1 when an event is acknowledged, 0 when it is dropped
+typedef void (*udp_uplink_callback_t)(uint8_t delivered);
+
+void udp_uplink_init(udp_uplink_callback_t callback);
+
+// Queues an event for confirmed delivery to the DODAG root.
+// Returns 1 if the event was queued, 0 if the queue is full.
+int udp_uplink_send(const char *payload, uint16_t len);
+
+#endif /* UDP_UPLINK_H_ */
@@ -0,0 +1,435 @@
+/*
+ * Host bridge of the compressed framing (border router built with
+ * make UPLINK=udp FRAMING=compressed), run with node instead of pointing
+ * tunslip6 at the serial line:
+ *
+ *   node host-bridge.js --serial /dev/ttyACM0 [--baud 115200] [--listen 60002]
+ *                       [--broker 127.0.0.1:1883] [--exec "<tunslip6 command>"]
+ *
+ * --serial is a device or host:port (the Cooja serial socket, 127.0.0.1:60001).
+ * The SLIP frames starting with UPLINK_FRAME_MARKER are the motes' events
+ * (common/uplink-framing.h): they are rebuilt and published with QoS 1 on
+ * nsds_gm/contacts/<address>, as the MQTT bridge of the border router does.
+ * Lines of serial text the border router printed without SLIP framing (boot
+ * logs) end up in front of the next frame; they are printed here and the frame
+ * is classified after them. Every other frame, IPv6 or tunslip6 commands and
+ * logs, is passed unchanged to the tunslip6 connected on --listen
+ * (tunslip6 -a 127.0.0.1 -p 60002), and its traffic back to the serial line.
+ * --exec starts that tunslip6 once listening.
+ */
+const net = require('net');
+const fs = require('fs');
+const childProcess = require('child_process');
+
+const SLIP_END = 0xc0;
+const SLIP_ESC = 0xdb;
+const SLIP_ESC_END = 0xdc;
+const SLIP_ESC_ESC = 0xdd;
+
+// common/uplink-framing.h
+const FRAME_MARKER = 0x23;
+const FRAME_REPORT = 0;
+const FRAME_REPEAT = 1;
+const FRAME_RAW = 2;
+const FRAME_KIND = 0x0f;
+const FRAME_DEFINE = 0x80;
+const FRAME_NEXT_SEQ = 0x40;
+
+const TOPIC_PREFIX = 'nsds_gm/contacts/';
+
+function fnv1a(buffer) {
+    let h = 2166136261;
+    for (let i = 0; i < buffer.length; i++) {
+        h = Math.imul(h ^ buffer[i], 16777619) >>> 0;
+    }
+    return h;
+}
+
+// UPLINK_FRAME_CHECK
+function frameCheck(hash, seq) {
+    return (hash ^ (hash >>> 8) ^ (hash >>> 16) ^ (hash >>> 24) ^ seq ^ (seq >> 8)) & 0xff;
+}
+
+// Splits a byte stream into SLIP frames. onFrame(raw) gets the escaped bytes
+// of each frame with its END, so that frames passed on are left untouched.
+function SlipSplitter(onFrame) {
+    this.onFrame = onFrame;
+    this.chunks = [];
+}
+
+SlipSplitter.prototype.push = function (data) {
+    let start = 0;
+    for (let i = 0; i < data.length; i++) {
+        if (data[i] === SLIP_END) {
+            this.chunks.push(data.subarray(start, i + 1));
+            const raw = this.chunks.length === 1 ? this.chunks[0] : Buffer.concat(this.chunks);
+            this.chunks = [];
+            start = i + 1;
+            this.onFrame(raw);
+        }
+    }
+    if (start < data.length) {
+        this.chunks.push(Buffer.from(data.subarray(start)));
+    }
+};
+
+// Returns where an event frame starts in the escaped bytes of a SLIP frame: 0,
+// or after the lines of serial text in front of it. -1 if it is not an event.
+// Text and the marker are never escaped, so the frame is not decoded for this.
+function frameStart(raw) {
+    if (raw[0] === FRAME_MARKER) {
+        return 0;
+    }
+    for (let i = 0; i + 1 < raw.length; i++) {
+        const c = raw[i];
+        if (c === 0x0a && raw[i + 1] === FRAME_MARKER) {
+            return i + 1;
+        }
+        if (c !== 0x0a && c !== 0x0d && c !== 0x09 && (c < 0x20 || c > 0x7e)) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+function slipDecode(raw) {
+    const out = Buffer.allocUnsafe(raw.length);
+    let n = 0;
+    for (let i = 0; i < raw.length && raw[i] !== SLIP_END; i++) {
+        if (raw[i] === SLIP_ESC && i + 1 < raw.length) {
+            i++;
+            out[n++] = raw[i] === SLIP_ESC_END ? SLIP_END : raw[i] === SLIP_ESC_ESC ? SLIP_ESC : raw[i];
+        } else {
+            out[n++] = raw[i];
+        }
+    }
+    return out.subarray(0, n);
+}
+
+function slipEncode(frame) {
+    const out = Buffer.allocUnsafe(frame.length * 2 + 1);
+    let n = 0;
+    for (let i = 0; i < frame.length; i++) {
+        if (frame[i] === SLIP_END) {
+            out[n++] = SLIP_ESC;
+            out[n++] = SLIP_ESC_END;
+        } else if (frame[i] === SLIP_ESC) {
+            out[n++] = SLIP_ESC;
+            out[n++] = SLIP_ESC_ESC;
+        } else {
+            out[n++] = frame[i];
+        }
+    }
+    out[n++] = SLIP_END;
+    return out.subarray(0, n);
+}
+
+// Rebuilds the events from the frames, with what it learnt of each topic id
+function FrameDecoder() {
+    this.topics = new Array(256).fill(null);
+    this.events = 0;
+    this.unknown = 0;   // Frames of a topic not defined yet, or dropped after a mismatch
+    this.mismatch = 0;  // Frames whose check byte disagreed with the rebuilt event
+    this.malformed = 0;
+}
+
+// Returns { topic, payload } for a decoded frame (marker included), or null
+FrameDecoder.prototype.decode = function (frame) {
+    if (frame.length < 3 || frame[0] !== FRAME_MARKER) {
+        this.malformed++;
+        return null;
+    }
+    const flags = frame[1];
+    const kind = flags & FRAME_KIND;
+    const id = frame[2];
+    let n = 3;
+
+    if (flags & FRAME_DEFINE) {
+        const length = frame[n++];
+        this.topics[id] = { name: TOPIC_PREFIX + frame.toString('latin1', n, n + length), body: null, hash: 0, seq: 0 };
+        n += length;
+    }
+    const topic = this.topics[id];
+    if (topic === null || n > frame.length) {
+        this.unknown++;
+        return null;
+    }
+    if (kind === FRAME_RAW) {
+        this.events++;
+        return { topic: topic.name, payload: frame.subarray(n) };
+    }
+
+    let seq;
+    if (flags & FRAME_NEXT_SEQ) {
+        if (topic.body === null) {
+            this.unknown++;
+            return null;
+        }
+        seq = (topic.seq + 1) & 0xffff;
+    } else {
+        seq = frame.readUInt16BE(n);
+        n += 2;
+    }
+    const check = frame[n++];
+    if (kind === FRAME_REPORT) {
+        topic.body = Buffer.from(frame.subarray(n));
+        topic.hash = fnv1a(topic.body);
+    } else if (kind !== FRAME_REPEAT || topic.body === null) {
+        this.unknown++;
+        return null;
+    }
+    if (check !== frameCheck(topic.hash, seq)) {
+        // Out of step with the border router until the topic is defined again
+        this.mismatch++;
+        this.topics[id] = null;
+        return null;
+    }
+    topic.seq = seq;
+    this.events++;
+    return { topic: topic.name, payload: Buffer.concat([Buffer.from('{"seq": ' + seq + ', '), topic.body]) };
+};
+
+// Minimal MQTT 3.1.1 client: QoS 1 publishes, keepalive, reconnection. The
+// border router has already acknowledged the events to the motes, so an event
+// stays here until its PUBACK: publishes in flight when the connection drops
+// are sent again (DUP) once it is back, and events published while the broker
+// is away wait in a bounded queue.
+function MqttPublisher(host, port, clientId) {
+    this.host = host;
+    this.port = port;
+    this.clientId = clientId;
+    this.socket = null;
+    this.connected = false;
+    this.received = Buffer.alloc(0);
+    this.pending = [];          // Events not sent yet
+    this.inFlight = new Map();  // Packet id -> event sent and waiting for its PUBACK, in sending order
+    this.nextId = 1;
+    this.published = 0;
+    this.acked = 0;
+    this.resent = 0;
+    this.dropped = 0;
+    this.connect();
+}
+
+const MQTT_KEEP_ALIVE = 60;
+const MQTT_QUEUE_SIZE = 4096;
+const MQTT_MAX_IN_FLIGHT = 64;
+
+const MQTT_CONNACK = 0x20;
+const MQTT_PUBLISH_QOS1 = 0x32;
+const MQTT_PUBLISH_DUP = 0x08;
+const MQTT_PUBACK = 0x40;
+
+function mqttString(s) {
+    const b = Buffer.from(s, 'utf8');
+    const out = Buffer.allocUnsafe(2 + b.length);
+    out.writeUInt16BE(b.length, 0);
+    b.copy(out, 2);
+    return out;
+}
+
+function mqttPacket(type, body) {
+    const length = [];
+    let x = body.length;
+    do {
+        let digit = x % 128;
+        x = Math.floor(x / 128);
+        length.push(x > 0 ? digit | 0x80 : digit);
+    } while (x > 0);
+    return Buffer.concat([Buffer.from([type].concat(length)), body]);
+}
+
+MqttPublisher.prototype.connect = function () {
+    const self = this;
+    this.received = Buffer.alloc(0);
+    this.socket = net.connect(this.port, this.host, function () {
+        const header = Buffer.from([0x00, 0x04, 0x4d, 0x51, 0x54, 0x54, 0x04, 0x02, 0, MQTT_KEEP_ALIVE]);
+        self.socket.write(mqttPacket(0x10, Buffer.concat([header, mqttString(self.clientId)])));
+    });
+    this.socket.on('data', function (data) {
+        self.receive(data);
+    });
+    this.socket.on('error', function () {});
+    this.socket.on('close', function () {
+        if (self.connected) {
+            console.log('Disconnected from the MQTT broker, ' + self.inFlight.size + ' publishes unacknowledged');
+        }
+        self.connected = false;
+        setTimeout(function () { self.connect(); }, 2000);
+    });
+};
+
+// Splits the broker's stream into packets, which may arrive in pieces
+MqttPublisher.prototype.receive = function (data) {
+    this.received = this.received.length > 0 ? Buffer.concat([this.received, data]) : data;
+    while (this.received.length >= 2) {
+        let length = 0;
+        let n = 1;
+        let multiplier = 1;
+        do {
+            if (n >= this.received.length) {
+                return;
+            }
+            length += (this.received[n] & 0x7f) * multiplier;
+            multiplier *= 128;
+        } while (this.received[n++] & 0x80);
+        if (this.received.length < n + length) {
+            return;
+        }
+        const type = this.received[0] & 0xf0;
+        const body = this.received.subarray(n, n + length);
+        this.received = this.received.subarray(n + length);
+
+        if (type === MQTT_CONNACK && body.length >= 2 && body[1] === 0) {
+            this.connected = true;
+            console.log('Connected to the MQTT broker');
+            this.resend();
+            this.flush();
+        } else if (type === MQTT_PUBACK && body.length >= 2 && this.inFlight.delete(body.readUInt16BE(0))) {
+            this.acked++;
+            this.flush();
+        }
+    }
+};
+
+MqttPublisher.prototype.publish = function (topic, payload) {
+    if (this.pending.length >= MQTT_QUEUE_SIZE) {
+        this.pending.shift();
+        this.dropped++;
+    }
+    this.pending.push([topic, payload]);
+    if (this.connected) {
+        this.flush();
+    }
+};
+
+MqttPublisher.prototype.send = function (id, event, flags) {
+    const packetId = Buffer.from([id >> 8, id & 0xff]);
+    this.socket.write(mqttPacket(MQTT_PUBLISH_QOS1 | flags, Buffer.concat([mqttString(event[0]), packetId, event[1]])));
+};
+
+// Sends the queued events while the in-flight window has room
+MqttPublisher.prototype.flush = function () {
+    while (this.connected && this.pending.length > 0 && this.inFlight.size < MQTT_MAX_IN_FLIGHT) {
+        const event = this.pending.shift();
+        while (this.inFlight.has(this.nextId)) {
+            this.nextId = this.nextId === 0xffff ? 1 : this.nextId + 1;
+        }
+        const id = this.nextId;
+        this.nextId = this.nextId === 0xffff ? 1 : this.nextId + 1;
+        this.inFlight.set(id, event);
+        this.send(id, event, 0);
+        this.published++;
+    }
+};
+
+// Sends again, in their order, the publishes of a previous connection that got no PUBACK
+MqttPublisher.prototype.resend = function () {
+    const self = this;
+    this.inFlight.forEach(function (event, id) {
+        self.send(id, event, MQTT_PUBLISH_DUP);
+        self.resent++;
+    });
+};
+
+MqttPublisher.prototype.ping = function () {
+    if (this.connected) {
+        this.socket.write(Buffer.from([0xc0, 0x00]));
+    }
+};
+
+function openSerial(spec, baud, onData) {
+    const m = spec.match(/^(.*):(\d+)$/);
+    if (m) {
+        const socket = net.connect(Number(m[2]), m[1]);
+        socket.on('data', onData);
+        socket.on('error', function (err) {
+            console.error('Serial socket ' + spec + ': ' + err.message);
+            process.exit(1);
+        });
+        return function (data) { socket.write(data); };
+    }
+    childProcess.execFileSync('stty', ['-F', spec, String(baud), 'raw', '-echo']);
+    fs.createReadStream(spec).on('data', onData);
+    const out = fs.createWriteStream(spec);
+    return function (data) { out.write(data); };
+}
+
+function main() {
+    const options = { serial: null, baud: 115200, listen: 60002, broker: '127.0.0.1:1883', exec: null };
+    for (let i = 2; i < process.argv.length; i += 2) {
+        const key = process.argv[i].replace(/^--/, '');
+        if (!(key in options) || i + 1 >= process.argv.length) {
+            console.error('usage: node host-bridge.js --serial <device|host:port> [--baud n] [--listen port] ' +
+                          '[--broker host:port] [--exec command]');
+            process.exit(1);
+        }
+        options[key] = process.argv[i + 1];
+    }
+    if (!options.serial) {
+        console.error('--serial is required');
+        process.exit(1);
+    }
+
+    const broker = options.broker.match(/^(.*):(\d+)$/);
+    const mqtt = new MqttPublisher(broker[1], Number(broker[2]), 'd:host-bridge:' + process.pid);
+    const decoder = new FrameDecoder();
+    let tunslip = null;
+    let passed = 0;
+
+    const splitter = new SlipSplitter(function (raw) {
+        const start = frameStart(raw);
+        if (start >= 0) {
+            if (start > 0) {
+                process.stdout.write(raw.subarray(0, start));
+            }
+            const event = decoder.decode(slipDecode(raw.subarray(start)));
+            if (event) {
+                mqtt.publish(event.topic, event.payload);
+            }
+        } else if (tunslip) {
+            tunslip.write(raw);
+            passed++;
+        }
+    });
+    const writeSerial = openSerial(options.serial, Number(options.baud), function (data) {
+        splitter.push(data);
+    });
+
+    const server = net.createServer(function (socket) {
+        if (tunslip) {
+            socket.destroy();
+            return;
+        }
+        console.log('tunslip6 connected');
+        tunslip = socket;
+        socket.on('data', writeSerial);
+        socket.on('error', function () {});
+        socket.on('close', function () {
+            console.log('tunslip6 disconnected');
+            tunslip = null;
+        });
+    });
+    server.listen(Number(options.listen), '127.0.0.1', function () {
+        console.log('Host bridge on ' + options.serial + ', tunslip6 on port ' + options.listen);
+        if (options.exec) {
+            childProcess.spawn(options.exec, { shell: true, stdio: 'inherit' }).on('exit', function (code) {
+                process.exit(code || 0);
+            });
+        }
+    });
+
+    setInterval(function () { mqtt.ping(); }, MQTT_KEEP_ALIVE * 500);
+    setInterval(function () {
+        console.log('Events ' + decoder.events + ' (published ' + mqtt.published + ', acked ' + mqtt.acked +
+                    ', resent ' + mqtt.resent + ', dropped ' + mqtt.dropped + '), unknown topic ' + decoder.unknown +
+                    ', mismatch ' + decoder.mismatch + ', frames to tunslip6 ' + passed);
+    }, 60000);
+}
+
+module.exports = { FrameDecoder: FrameDecoder, SlipSplitter: SlipSplitter, frameStart: frameStart,
+                   slipEncode: slipEncode, slipDecode: slipDecode, fnv1a: fnv1a, frameCheck: frameCheck };
+
+if (require.main === module) {
+    main();
+}
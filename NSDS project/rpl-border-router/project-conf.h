@@ -0,0 +1,23 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+/*---------------------------------------------------------------------------*/
+/* Bridge the motes' UDP uplink to MQTT (make UPLINK=udp) */
+#ifndef BORDER_ROUTER_CONF_UPLINK_BRIDGE
+#define BORDER_ROUTER_CONF_UPLINK_BRIDGE 0
+#endif
+//*---------------------------------------------------------------------------*/
+/* Events leave as compressed serial frames instead of MQTT (make FRAMING=compressed) */
+#ifndef BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+#define BORDER_ROUTER_CONF_COMPRESSED_FRAMING 0
+#endif
+//*---------------------------------------------------------------------------*/
+/* The bridge holds a single MQTT connection to the broker */
+#if BORDER_ROUTER_CONF_UPLINK_BRIDGE && !BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+#define UIP_CONF_TCP 1
+#endif
+//*---------------------------------------------------------------------------*/
+/* TSCH and Orchestra schedule (make MAC=tsch) */
+#include "tsch-schedule.h"
+//*---------------------------------------------------------------------------*/
+#endif /* PROJECT_CONF_H_ */
+/*---------------------------------------------------------------------------*/
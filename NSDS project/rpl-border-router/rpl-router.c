@@ -27,6 +27,11 @@ PROCESS_THREAD(border_router_process, ev, data)
         process_start(&webserver_nogui_process, NULL);
     #endif /* BORDER_ROUTER_CONF_WEBSERVER */
 
+    #if BORDER_ROUTER_CONF_UPLINK_BRIDGE
+        PROCESS_NAME(uplink_bridge_process);
+        process_start(&uplink_bridge_process, NULL);
+    #endif /* BORDER_ROUTER_CONF_UPLINK_BRIDGE */
+
     LOG_INFO(" RPL Border Router started\n UDP DAG root started\n");
     PROCESS_END();
 }
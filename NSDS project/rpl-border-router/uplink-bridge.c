@@ -0,0 +1,327 @@
+#include "contiki.h"
+#include "string.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+#include "net/routing/routing.h"
+#include "net/ipv6/simple-udp.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uiplib.h"
+#include "sys/etimer.h"
+
+#include "uplink.h"
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+#include "dev/slip.h"
+#include "uplink-framing.h"
+#else
+#include "mqtt.h"
+#endif
+
+#include "sys/log.h"
+#define LOG_MODULE "Bridge"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+#define MQTT_BROKER_IP_ADDR "fd00::1"
+#define MQTT_PUB_TOPIC_CONTACTS "nsds_gm/contacts/"
+#define DEFAULT_BROKER_PORT 1883
+#define DEFAULT_KEEP_ALIVE_TIMER 60
+#define MAX_TCP_SEGMENT_SIZE 128
+#define BUFFER_SIZE 64
+
+#define NET_RETRY (CLOCK_SECOND * 10)
+#define DRAIN_PERIODIC (CLOCK_SECOND >> 2)
+// Every topic is defined again to the host bridge this often
+#define FRAMING_EPOCH_PERIOD (CLOCK_SECOND * 60)
+
+// Number of datagrams waiting to be published and of motes tracked for duplicates
+#define BRIDGE_QUEUE_SIZE 16
+#define BRIDGE_MAX_SENDERS 64
+// A mote has one event in flight, so a retransmission repeats one of its last
+// seqs. Further back, the mote rebooted and started again from a random seq.
+#define BRIDGE_SEQ_WINDOW 8
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING && BRIDGE_MAX_SENDERS > 256
+#error "Topic ids are a byte, the bridge can track at most 256 motes"
+#endif
+
+// Event received from a mote, waiting to be published to the broker
+typedef struct bridge_event
+{
+    struct bridge_event *next;
+    uip_ipaddr_t sender;
+    uint16_t len;
+    char payload[UPLINK_MAX_PAYLOAD];
+} bridge_event_t;
+
+// Last sequence number accepted from each mote
+typedef struct bridge_sender
+{
+    struct bridge_sender *next;
+    uip_ipaddr_t ipaddr;
+    uint16_t last_seq;
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+    uint8_t topic_id; // Kept when the entry is recycled for another mote
+    uplink_framing_topic_t framing;
+#endif
+} bridge_sender_t;
+
+MEMB(bridge_events_memb, bridge_event_t, BRIDGE_QUEUE_SIZE);
+LIST(bridge_events_list);
+MEMB(bridge_senders_memb, bridge_sender_t, BRIDGE_MAX_SENDERS);
+LIST(bridge_senders_list);
+
+PROCESS(uplink_bridge_process, "UDP uplink bridge");
+
+static struct simple_udp_connection uplink_conn;
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+static uint8_t next_topic_id;
+static uint8_t framing_epoch = 1;
+static struct timer epoch_timer;
+static uint8_t frame[UPLINK_FRAME_MAX];
+#else
+static struct mqtt_connection conn;
+static char client_id[BUFFER_SIZE];
+static char pub_topic[BUFFER_SIZE];
+static uint8_t connected;
+static uint8_t in_flight;
+#endif
+static struct etimer drain_timer;
+
+static bridge_sender_t *lookup_sender(const uip_ipaddr_t *addr)
+{
+    bridge_sender_t *sender;
+
+    for (sender = list_head(bridge_senders_list); sender != NULL; sender = list_item_next(sender))
+    {
+        if (uip_ipaddr_cmp(&sender->ipaddr, addr))
+        {
+            // Keep the most recently heard motes at the head of the list
+            list_remove(bridge_senders_list, sender);
+            list_push(bridge_senders_list, sender);
+            return sender;
+        }
+    }
+    return NULL;
+}
+
+static bridge_sender_t *add_sender(const uip_ipaddr_t *addr)
+{
+    bridge_sender_t *sender = memb_alloc(&bridge_senders_memb);
+
+    if (sender == NULL)
+    {
+        // Table full: recycle the least recently heard mote
+        sender = list_chop(bridge_senders_list);
+    }
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+    else
+    {
+        // A new entry takes the next topic id, a recycled one keeps its own
+        sender->topic_id = next_topic_id++;
+    }
+    // The host bridge learns the new mote behind the topic id with its next event
+    memset(&sender->framing, 0, sizeof(sender->framing));
+#endif
+    uip_ipaddr_copy(&sender->ipaddr, addr);
+    list_push(bridge_senders_list, sender);
+    return sender;
+}
+
+static void send_ack(const uip_ipaddr_t *addr, uint16_t seq)
+{
+    uplink_hdr_t ack;
+
+    ack.type = UPLINK_MSG_ACK;
+    ack.flags = 0;
+    ack.seq = UIP_HTONS(seq);
+    simple_udp_sendto(&uplink_conn, &ack, sizeof(ack), addr);
+}
+
+static void uplink_rx_callback(struct simple_udp_connection *c,
+                               const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+                               const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+                               const uint8_t *data, uint16_t datalen)
+{
+    uplink_hdr_t hdr;
+    uint16_t seq;
+    bridge_sender_t *sender;
+    bridge_event_t *event;
+
+    if (datalen < sizeof(hdr) || datalen > sizeof(hdr) + UPLINK_MAX_PAYLOAD)
+    {
+        return;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.type != UPLINK_MSG_EVENT)
+    {
+        return;
+    }
+    seq = UIP_NTOHS(hdr.seq);
+
+    // Retransmission of an event that was already accepted: only the ACK got lost
+    sender = lookup_sender(sender_addr);
+    if (sender != NULL && !UPLINK_SEQ_NEWER(seq, sender->last_seq))
+    {
+        if ((uint16_t)(sender->last_seq - seq) < BRIDGE_SEQ_WINDOW)
+        {
+            send_ack(sender_addr, seq);
+            return;
+        }
+        LOG_INFO("Mote restarted, seq=%u after %u\n", seq, sender->last_seq);
+    }
+
+    // No ACK when the queue is full, the mote retransmits later
+    event = memb_alloc(&bridge_events_memb);
+    if (event == NULL)
+    {
+        LOG_WARN("Queue full, dropping seq=%u\n", seq);
+        return;
+    }
+    uip_ipaddr_copy(&event->sender, sender_addr);
+    event->len = datalen - sizeof(hdr);
+    memcpy(event->payload, data + sizeof(hdr), event->len);
+    list_add(bridge_events_list, event);
+
+    if (sender == NULL)
+    {
+        sender = add_sender(sender_addr);
+    }
+    sender->last_seq = seq;
+    send_ack(sender_addr, seq);
+    process_poll(&uplink_bridge_process);
+}
+
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+// Writes the queued events to the host bridge over the serial line, with the
+// topic of the mote compacted to its id and repeated reports delta-encoded
+static void publish_queue(void)
+{
+    char addr[UIPLIB_IPV6_MAX_STR_LEN];
+    bridge_event_t *event;
+    bridge_sender_t *sender;
+
+    if (timer_expired(&epoch_timer))
+    {
+        // 0 is the epoch of a topic never defined
+        framing_epoch = framing_epoch == 0xff ? 1 : framing_epoch + 1;
+        timer_restart(&epoch_timer);
+    }
+
+    while ((event = list_pop(bridge_events_list)) != NULL)
+    {
+        // The senders of the queued events are among the most recent ones, never recycled
+        sender = lookup_sender(&event->sender);
+        if (sender != NULL)
+        {
+            uiplib_ipaddr_snprint(addr, sizeof(addr), &event->sender);
+            slip_write(frame, uplink_framing_encode(&sender->framing, sender->topic_id, framing_epoch, addr + 6,
+                                                    event->payload, event->len, frame));
+        }
+        memb_free(&bridge_events_memb, event);
+    }
+}
+#else
+// Publishes the head of the queue on the mote's own contacts topic
+static void publish_head(void)
+{
+    char addr[UIPLIB_IPV6_MAX_STR_LEN];
+    bridge_event_t *event = list_head(bridge_events_list);
+
+    if (event == NULL || in_flight || !connected || !mqtt_ready(&conn) || !conn.out_buffer_sent)
+    {
+        return;
+    }
+
+    // Same topic layout as the motes publishing directly: prefix plus address without "fd00::"
+    uiplib_ipaddr_snprint(addr, sizeof(addr), &event->sender);
+    snprintf(pub_topic, sizeof(pub_topic), "%s%s", MQTT_PUB_TOPIC_CONTACTS, addr + 6);
+
+    if (mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)event->payload, event->len,
+                     MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF) == MQTT_STATUS_OK)
+    {
+        in_flight = 1;
+    }
+}
+
+static void mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+    bridge_event_t *head;
+
+    switch (event)
+    {
+    case MQTT_EVENT_CONNECTED:
+        LOG_INFO("Connected to the MQTT broker\n");
+        connected = 1;
+        in_flight = 0;
+        process_poll(&uplink_bridge_process);
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        LOG_INFO("Disconnected from the MQTT broker\n");
+        connected = 0;
+        process_poll(&uplink_bridge_process);
+        break;
+    case MQTT_EVENT_PUBACK:
+        head = list_pop(bridge_events_list);
+        if (head != NULL)
+        {
+            memb_free(&bridge_events_memb, head);
+        }
+        in_flight = 0;
+        process_poll(&uplink_bridge_process);
+        break;
+    default:
+        break;
+    }
+}
+#endif /* BORDER_ROUTER_CONF_COMPRESSED_FRAMING */
+
+PROCESS_THREAD(uplink_bridge_process, ev, data)
+{
+    PROCESS_BEGIN();
+
+    memb_init(&bridge_events_memb);
+    list_init(bridge_events_list);
+    memb_init(&bridge_senders_memb);
+    list_init(bridge_senders_list);
+
+    simple_udp_register(&uplink_conn, UPLINK_UDP_PORT, NULL, UPLINK_UDP_PORT, uplink_rx_callback);
+
+#if BORDER_ROUTER_CONF_COMPRESSED_FRAMING
+    timer_set(&epoch_timer, FRAMING_EPOCH_PERIOD);
+    LOG_INFO("UDP uplink bridge started on port %u, compressed framing\n", UPLINK_UDP_PORT);
+
+    while (1)
+    {
+        publish_queue();
+        etimer_set(&drain_timer, DRAIN_PERIODIC);
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&drain_timer));
+    }
+#else
+    snprintf(client_id, sizeof(client_id), "d:uplink-bridge:%02x%02x",
+             linkaddr_node_addr.u8[6], linkaddr_node_addr.u8[7]);
+    mqtt_register(&conn, &uplink_bridge_process, client_id, mqtt_event, MAX_TCP_SEGMENT_SIZE);
+    conn.auto_reconnect = 0;
+
+    LOG_INFO("UDP uplink bridge started on port %u\n", UPLINK_UDP_PORT);
+
+    while (1)
+    {
+        if (!connected)
+        {
+            mqtt_connect(&conn, MQTT_BROKER_IP_ADDR, DEFAULT_BROKER_PORT, DEFAULT_KEEP_ALIVE_TIMER);
+            etimer_set(&drain_timer, NET_RETRY);
+            PROCESS_WAIT_EVENT_UNTIL(connected || etimer_expired(&drain_timer));
+            if (!connected)
+            {
+                mqtt_disconnect(&conn);
+                continue;
+            }
+        }
+
+        publish_head();
+        etimer_set(&drain_timer, DRAIN_PERIODIC);
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&drain_timer));
+    }
+#endif
+
+    PROCESS_END();
+}
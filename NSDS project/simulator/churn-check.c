@@ -0,0 +1,257 @@
+// Long-run churn check of the contact engine pool on the host: a few engines
+// hear a population of neighbours several times the pool size come and go,
+// fade out of proximity, fall silent and expire, with bad frees thrown in
+// (double frees, entries of another engine, pointers into an entry). The pool
+// invariants are checked throughout, and once every neighbour has expired the
+// pool must be empty again.
+//
+//   ./churn-check [steps] [seed]
+//
+// Defaults: 10 million steps, seed 1. Exits with 1 on the first broken
+// invariant, so it can gate a build (make churn-check).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contact-engine.h"
+
+#define ENGINES 4
+#define POPULATION (3 * MAX_CONTACTS)
+#define CHECK_EVERY 1000
+
+// Same signal model as contact-sim: strong enough to enter proximity or weak
+// enough to leave it
+#define RSSI_NEAR -20
+#define RSSI_FAR -90
+
+static contact_engine_t engines[ENGINES];
+static uint64_t rng_state;
+static unsigned long departures;
+static uint16_t expected_bad_frees[ENGINES];
+
+static uint32_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static void neighbour_address(uip_ipaddr_t *addr, uint32_t id)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0xfd;
+    addr->u8[11] = id >> 16;
+    addr->u8[12] = id >> 8;
+    addr->u8[13] = id;
+}
+
+static void count_departure(contact_engine_t *engine, const contact_t *contact)
+{
+    (void)engine;
+    (void)contact;
+    departures++;
+}
+
+static int is_set(const uint8_t *set, int slot)
+{
+    return set[slot >> 3] & (1 << (slot & 7));
+}
+
+static void fail(int e, unsigned long step, const char *what)
+{
+    fprintf(stderr, "Engine %d, step %lu: %s\n", e, step, what);
+    exit(1);
+}
+
+// Checks that the pool accounts for every slot and that no entry refers to a
+// freed one
+static void check_engine(int e, unsigned long step)
+{
+    contact_engine_t *engine = &engines[e];
+    contact_pool_stats_t *pool = &engine->pool;
+    int used = 0;
+    int slot, other;
+
+    for (slot = 0; slot < MAX_CONTACTS; slot++)
+    {
+        const contact_t *c = &engine->contacts[slot];
+        if (!is_set(engine->used, slot))
+        {
+            continue;
+        }
+        used++;
+        if (c->slot != slot)
+        {
+            fail(e, step, "entry does not know its slot");
+        }
+        if (contact_engine_find(engine, &c->ipaddr) != c)
+        {
+            fail(e, step, "entry cannot be found by its address");
+        }
+        for (other = 0; other < MAX_CONTACTS; other++)
+        {
+            if (!is_set(c->mutual_contacts, other))
+            {
+                continue;
+            }
+            if (other == slot || !is_set(engine->used, other))
+            {
+                fail(e, step, "mutual contact bit of a freed slot");
+            }
+            if (!is_set(engine->contacts[other].mutual_contacts, slot))
+            {
+                fail(e, step, "mutual contact bit set one way only");
+            }
+        }
+    }
+    for (slot = MAX_CONTACTS; slot < CONTACT_SET_BYTES * 8; slot++)
+    {
+        if (is_set(engine->used, slot))
+        {
+            fail(e, step, "slot past the pool marked used");
+        }
+    }
+#if CONTACT_HASH_INDEX
+    {
+        int buckets = 0;
+        for (slot = 0; slot < CONTACT_INDEX_SIZE; slot++)
+        {
+            buckets += engine->index[slot] != 0;
+        }
+        if (buckets != used)
+        {
+            fail(e, step, "index buckets leaked or lost");
+        }
+    }
+#endif
+
+    if (used != pool->in_use || pool->allocs - pool->frees != pool->in_use)
+    {
+        fail(e, step, "pool occupancy does not match the allocated slots");
+    }
+    if (pool->in_use > pool->high_water || pool->high_water > MAX_CONTACTS)
+    {
+        fail(e, step, "pool high water out of range");
+    }
+    if (pool->bad_frees != expected_bad_frees[e])
+    {
+        fail(e, step, "bad free accepted or good free refused");
+    }
+}
+
+// Frees the pool must refuse: an entry it already freed, an entry of another
+// engine and a pointer into the middle of an entry
+static void bad_free(int e, unsigned long step)
+{
+    contact_engine_t *engine = &engines[e];
+    contact_t *c = contact_engine_next(engine, NULL);
+    contact_t stale;
+
+    if (c == NULL)
+    {
+        return;
+    }
+    stale = *c;
+    if (!contact_engine_remove(engine, c))
+    {
+        fail(e, step, "could not free an allocated entry");
+    }
+    contact_engine_remove(engine, c);
+    expected_bad_frees[e]++;
+    contact_engine_remove(engine, &stale);
+    expected_bad_frees[e]++;
+    c = contact_engine_next(&engines[(e + 1) % ENGINES], NULL);
+    if (c != NULL)
+    {
+        contact_engine_remove(engine, c);
+        expected_bad_frees[e]++;
+    }
+    c = contact_engine_next(engine, NULL);
+    if (c != NULL)
+    {
+        contact_engine_remove(engine, (contact_t *)((uint8_t *)c + 1));
+        expected_bad_frees[e]++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long steps = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000UL;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+    clock_time_t now = 0;
+    unsigned long step;
+    unsigned long allocs = 0, dropped = 0, bad = 0;
+    int high_water = 0;
+    int e;
+
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    for (e = 0; e < ENGINES; e++)
+    {
+        contact_engine_init(&engines[e], count_departure);
+    }
+
+    for (step = 1; step <= steps; step++)
+    {
+        uint32_t r = rng_next();
+        uip_ipaddr_t addr;
+        e = r % ENGINES;
+
+        // Neighbours near the start of the population are heard far more often,
+        // the tail comes and goes and keeps the pool full
+        neighbour_address(&addr, (rng_next() % POPULATION) * (rng_next() % POPULATION) / POPULATION);
+        contact_engine_heard(&engines[e], &addr, (r >> 8) % 4 ? RSSI_NEAR : RSSI_FAR, 105, now);
+        now += rng_next() % (CLOCK_SECOND / 10);
+
+        if ((r >> 12) % 64 == 0)
+        {
+            contact_engine_expire(&engines[e], now);
+        }
+        if ((r >> 20) % 4096 == 0)
+        {
+            bad_free(e, step);
+        }
+        if (step % CHECK_EVERY == 0)
+        {
+            check_engine(step / CHECK_EVERY % ENGINES, step);
+        }
+    }
+
+    // Past the inactivity threshold every neighbour has gone silent
+    now += CONTACT_INACTIVITY_THRESHOLD + 1;
+    for (e = 0; e < ENGINES; e++)
+    {
+        contact_engine_t *engine = &engines[e];
+        int i;
+
+        contact_engine_expire(engine, now);
+        check_engine(e, step);
+        if (engine->pool.in_use != 0 || contact_engine_next(engine, NULL) != NULL)
+        {
+            fail(e, step, "entries left after every neighbour expired");
+        }
+        for (i = 0; i < CONTACT_SET_BYTES; i++)
+        {
+            if (engine->used[i] != 0)
+            {
+                fail(e, step, "slots left marked used");
+            }
+        }
+        allocs += engine->pool.allocs;
+        dropped += engine->dropped;
+        bad += engine->pool.bad_frees;
+        if (engine->pool.high_water > high_water)
+        {
+            high_water = engine->pool.high_water;
+        }
+    }
+
+    printf("Churn: %lu steps over %lu s simulated, %d engines of %d contacts, %d neighbours each\n", steps,
+           (unsigned long)(now / CLOCK_SECOND), ENGINES, MAX_CONTACTS, POPULATION);
+    printf("Pool: %lu allocations, %lu departures, %lu neighbours dropped when full, high water %d\n", allocs,
+           departures, dropped, high_water);
+    printf("Bad frees refused: %lu\n", bad);
+    printf("Leaked slots: 0\n");
+    return 0;
+}
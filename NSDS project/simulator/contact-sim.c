@@ -0,0 +1,542 @@
+// Host simulator of the mote contact engine: runs the real contact-engine.c of
+// every mote on a discrete-event clock, without Cooja or the network stack.
+// Crowds of tens of thousands of motes run in seconds, which makes it practical
+// to sweep the engine parameters before a Cooja run.
+//
+//   ./contact-sim [options]            (./contact-sim --help for the list)
+//
+// Radio: unit disk of --range metres, no collisions, optional uniform loss.
+// The RSSI follows the Cooja UDGM model, so the proximity thresholds of
+// project-conf.h behave as in a Cooja run with the same range.
+// Beacon rounds follow the mote: one beacon every COMMUNICATION_LAG to each
+// entry of the neighbour table, then the round delay of the engine.
+// The neighbour table holds the first --neighbours motes in range, as the
+// Contiki one fills up in the order neighbours are discovered.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contact-engine.h"
+#include "neighbour-grid.h"
+
+#define COMMUNICATION_LAG (CLOCK_SECOND >> 1)
+#define ACTIVITY_CHECK (CLOCK_SECOND * 30)
+
+// Cooja UDGM signal model: -10 dBm next to the sender, -95 dBm at the range
+#define SS_STRONG -10
+#define SS_WEAK -95
+#define SIM_LQI 105
+
+enum event_type
+{
+    EV_ROUND,  // Start of a beacon round
+    EV_BEACON, // Next beacon of the round, arg is the neighbour table entry
+    EV_EXPIRE, // Activity check
+    EV_MOVE,   // Mobility step of every mobile mote
+};
+
+typedef struct event
+{
+    clock_time_t time;
+    uint32_t node;
+    uint8_t type;
+    uint8_t arg;
+} event_t;
+
+typedef struct node
+{
+    contact_engine_t engine; // First member, the departure callback gets back to the node through it
+    double tx, ty;           // Waypoint of a mobile mote
+    clock_time_t pause_until;
+    uint64_t rng;            // Own random stream, so mobility steps can run in parallel
+    uint8_t mobile;
+    uint8_t nbr_count;
+    uint32_t *nbrs;          // Neighbour table, snapshot at the start of each round
+} node_t;
+
+static struct
+{
+    uint32_t nodes;
+    double density; // Motes per hectare
+    double range;
+    clock_time_t send_interval;
+    clock_time_t contact_timeout;
+    clock_time_t inactivity;
+    clock_time_t duration;
+    double mobile;
+    double speed;
+    clock_time_t pause;
+    double loss;
+    unsigned neighbours;
+    unsigned long seed;
+} opt = {
+    .nodes = 10000,
+    .density = 10,
+    .range = 50,
+    .send_interval = CLOCK_SECOND * CONTACT_CONF_SEND_INTERVAL,
+    .contact_timeout = CONTACT_TIMEOUT,
+    .inactivity = CONTACT_INACTIVITY_THRESHOLD,
+    .duration = CLOCK_SECOND * 1800,
+    .mobile = 0,
+    .speed = 1.4,
+    .pause = CLOCK_SECOND * 30,
+    .loss = 0,
+    .neighbours = 16,
+    .seed = 1,
+};
+
+static struct
+{
+    unsigned long events;
+    unsigned long beacons;
+    unsigned long delivered;
+    unsigned long reports;
+    unsigned long report_members;
+    unsigned long departures;
+} stats;
+
+static node_t *nodes;
+static neighbour_grid_t grid; // Positions of the motes
+static double side;
+
+/*---------------------------------------------------------------------------*
+                                RANDOM NUMBERS
+/----------------------------------------------------------------------------*/
+// xorshift64*, seeded from --seed so that runs are reproducible
+static uint64_t rng_state;
+
+static uint32_t rng_step(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (uint32_t)((*state * 2685821657736338717ULL) >> 32);
+}
+
+static uint32_t rng_next(void)
+{
+    return rng_step(&rng_state);
+}
+
+static double rng_uniform(void)
+{
+    return rng_next() / 4294967296.0;
+}
+
+/*---------------------------------------------------------------------------*
+                                EVENT QUEUE
+/----------------------------------------------------------------------------*/
+static event_t *heap;
+static size_t heap_len;
+static size_t heap_cap;
+
+static void schedule(clock_time_t time, uint32_t node, uint8_t type, uint8_t arg)
+{
+    size_t i;
+
+    if (heap_len == heap_cap)
+    {
+        heap_cap = heap_cap ? heap_cap * 2 : 1024;
+        heap = realloc(heap, heap_cap * sizeof(*heap));
+        if (heap == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+
+    i = heap_len++;
+    while (i > 0 && heap[(i - 1) / 2].time > time)
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = (event_t){time, node, type, arg};
+}
+
+static event_t pop_event(void)
+{
+    event_t top = heap[0];
+    event_t last = heap[--heap_len];
+    size_t i = 0;
+
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= heap_len)
+        {
+            break;
+        }
+        if (child + 1 < heap_len && heap[child + 1].time < heap[child].time)
+        {
+            child++;
+        }
+        if (heap[child].time >= last.time)
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/*---------------------------------------------------------------------------*
+                                MOTES
+/----------------------------------------------------------------------------*/
+// Same layout as the Cooja motes: fd00::212:74XX:XXXX:XXXX from the mote id
+static void node_address(uint32_t id, uip_ipaddr_t *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0xfd;
+    addr->u8[8] = 0x02;
+    addr->u8[9] = 0x12;
+    addr->u8[10] = 0x74;
+    addr->u8[11] = (id >> 16) & 0xff;
+    addr->u8[12] = (id >> 8) & 0xff;
+    addr->u8[13] = id & 0xff;
+    addr->u8[14] = (id >> 8) & 0xff;
+    addr->u8[15] = id & 0xff;
+}
+
+static void report_departure(contact_engine_t *engine, const contact_t *contact)
+{
+    (void)engine;
+    (void)contact;
+    stats.departures++;
+}
+
+static int add_neighbour(uint32_t id, uint32_t other, void *ctx)
+{
+    (void)ctx;
+    nodes[id].nbrs[nodes[id].nbr_count++] = other;
+    return nodes[id].nbr_count < opt.neighbours;
+}
+
+static void start_round(uint32_t id, clock_time_t now)
+{
+    nodes[id].nbr_count = 0;
+    neighbour_grid_for_each(&grid, id, opt.range, add_neighbour, NULL);
+    schedule(now + COMMUNICATION_LAG, id, EV_BEACON, 0);
+}
+
+// Same as the udp_rx_callback of the mote followed by check_group_formation
+static void deliver_beacon(uint32_t from, uint32_t to, clock_time_t now)
+{
+    double d = neighbour_grid_distance(&grid, from, to);
+    double ratio = d / opt.range;
+    int16_t rssi;
+    uip_ipaddr_t addr;
+    int members;
+
+    // The neighbour may have moved out of range since the round started
+    if (d > opt.range || (opt.loss > 0 && rng_uniform() < opt.loss))
+    {
+        return;
+    }
+    stats.delivered++;
+
+    rssi = (int16_t)(SS_STRONG + ratio * ratio * (SS_WEAK - SS_STRONG));
+    node_address(from, &addr);
+    contact_engine_heard(&nodes[to].engine, &addr, rssi, SIM_LQI, now);
+
+    members = contact_engine_in_proximity(&nodes[to].engine);
+    if (members >= CONTACT_GROUP_MIN_SIZE)
+    {
+        stats.reports++;
+        stats.report_members += members;
+    }
+}
+
+static void send_beacon(uint32_t id, uint8_t entry, clock_time_t now)
+{
+    node_t *node = &nodes[id];
+
+    if (entry < node->nbr_count)
+    {
+        stats.beacons++;
+        deliver_beacon(id, node->nbrs[entry], now);
+        schedule(now + COMMUNICATION_LAG, id, EV_BEACON, entry + 1);
+    }
+    else
+    {
+        schedule(now + contact_engine_round_delay(opt.send_interval, (unsigned short)rng_next()), id, EV_ROUND, 0);
+    }
+}
+
+// Random waypoint, one step of a second. The motes move in parallel, each
+// with its own random stream, and only those that changed cell are relinked.
+static void move_nodes(clock_time_t now)
+{
+    int32_t i;
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < (int32_t)opt.nodes; i++)
+    {
+        node_t *node = &nodes[i];
+        double dx, dy, d;
+
+        if (!node->mobile || now < node->pause_until)
+        {
+            continue;
+        }
+        dx = node->tx - grid.x[i];
+        dy = node->ty - grid.y[i];
+        d = hypot(dx, dy);
+        if (d <= opt.speed)
+        {
+            grid.x[i] = node->tx;
+            grid.y[i] = node->ty;
+            node->tx = rng_step(&node->rng) / 4294967296.0 * side;
+            node->ty = rng_step(&node->rng) / 4294967296.0 * side;
+            node->pause_until = now + opt.pause;
+        }
+        else
+        {
+            grid.x[i] += dx / d * opt.speed;
+            grid.y[i] += dy / d * opt.speed;
+        }
+    }
+    neighbour_grid_update(&grid);
+}
+
+/*---------------------------------------------------------------------------*
+                                METRICS
+/----------------------------------------------------------------------------*/
+// Distances at which the RSSI crosses the enter and leave thresholds
+static double threshold_distance(int rssi)
+{
+    double ratio = (double)(rssi - SS_STRONG) / (SS_WEAK - SS_STRONG);
+    return ratio <= 0 ? 0 : (ratio >= 1 ? opt.range : sqrt(ratio) * opt.range);
+}
+
+// Compares what the engines believe with the true positions: a contact is
+// right if the neighbour is within the leave distance, and a neighbour within
+// the enter distance should be a contact
+static void print_accuracy(void)
+{
+    double enter = threshold_distance(PROXIMITY_RSSI_ENTER);
+    double leave = threshold_distance(PROXIMITY_RSSI_LEAVE);
+    unsigned long believed = 0, right = 0, close = 0, found = 0;
+    unsigned long dropped = 0, allocs = 0;
+    int high_water = 0;
+    uint32_t *degrees = malloc(opt.nodes * sizeof(*degrees));
+    uint32_t i;
+
+    if (degrees == NULL)
+    {
+        perror("malloc");
+        exit(1);
+    }
+    neighbour_grid_degrees(&grid, enter, degrees);
+
+    for (i = 0; i < opt.nodes; i++)
+    {
+        contact_engine_t *engine = &nodes[i].engine;
+        contact_t *c;
+
+        dropped += engine->dropped;
+        allocs += engine->pool.allocs;
+        if (engine->pool.high_water > high_water)
+        {
+            high_water = engine->pool.high_water;
+        }
+        for (c = contact_engine_next(engine, NULL); c != NULL; c = contact_engine_next(engine, c))
+        {
+            uint32_t other = ((uint32_t)c->ipaddr.u8[11] << 16) | ((uint32_t)c->ipaddr.u8[12] << 8) | c->ipaddr.u8[13];
+            if (c->in_proximity)
+            {
+                double d = neighbour_grid_distance(&grid, i, other);
+                believed++;
+                right += d <= leave;
+                found += d <= enter;
+            }
+        }
+        close += degrees[i];
+    }
+    free(degrees);
+
+    printf("Contacts: %.2f per mote, %.1f%% within %.1f m, %.1f%% of the %lu pairs within %.1f m found\n",
+           (double)believed / opt.nodes, believed ? 100.0 * right / believed : 0.0, leave,
+           close ? 100.0 * found / close : 0.0, close, enter);
+    printf("Pool full: %lu neighbours dropped (MAX_CONTACTS %d)\n", dropped, MAX_CONTACTS);
+    printf("Pool: %lu allocations, high water %d of %d\n", allocs, high_water, MAX_CONTACTS);
+}
+
+/*---------------------------------------------------------------------------*
+                                MAIN
+/----------------------------------------------------------------------------*/
+static void usage(const char *prog)
+{
+    printf("Usage: %s [options]\n"
+           "  --nodes N            motes (%u)\n"
+           "  --density D          motes per hectare (%.1f)\n"
+           "  --range M            radio range in metres (%.1f)\n"
+           "  --send-interval S    beacon period in seconds (%lu)\n"
+           "  --contact-timeout S  how long a sighting keeps contacts mutual (%lu)\n"
+           "  --inactivity S       how long a silent neighbour is kept (%lu)\n"
+           "  --neighbours N       neighbour table size (%u)\n"
+           "  --loss P             beacon loss probability (%.2f)\n"
+           "  --mobile F           fraction of mobile motes (%.2f)\n"
+           "  --speed V            speed of the mobile motes in m/s (%.1f)\n"
+           "  --pause S            pause at each waypoint in seconds (%lu)\n"
+           "  --duration S         simulated time in seconds (%lu)\n"
+           "  --seed N             random seed (%lu)\n"
+           "MAX_CONTACTS (%d) and the proximity thresholds are build options, see the Makefile.\n",
+           prog, opt.nodes, opt.density, opt.range, (unsigned long)(opt.send_interval / CLOCK_SECOND),
+           (unsigned long)(opt.contact_timeout / CLOCK_SECOND), (unsigned long)(opt.inactivity / CLOCK_SECOND),
+           opt.neighbours, opt.loss, opt.mobile, opt.speed, (unsigned long)(opt.pause / CLOCK_SECOND),
+           (unsigned long)(opt.duration / CLOCK_SECOND), opt.seed, MAX_CONTACTS);
+}
+
+static void parse_options(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *name = argv[i];
+        double value;
+
+        if (strcmp(name, "--help") == 0 || i + 1 >= argc)
+        {
+            usage(argv[0]);
+            exit(strcmp(name, "--help") == 0 ? 0 : 1);
+        }
+        value = atof(argv[++i]);
+
+        if (strcmp(name, "--nodes") == 0)
+            opt.nodes = (uint32_t)value;
+        else if (strcmp(name, "--density") == 0)
+            opt.density = value;
+        else if (strcmp(name, "--range") == 0)
+            opt.range = value;
+        else if (strcmp(name, "--send-interval") == 0)
+            opt.send_interval = (clock_time_t)(value * CLOCK_SECOND);
+        else if (strcmp(name, "--contact-timeout") == 0)
+            opt.contact_timeout = (clock_time_t)(value * CLOCK_SECOND);
+        else if (strcmp(name, "--inactivity") == 0)
+            opt.inactivity = (clock_time_t)(value * CLOCK_SECOND);
+        else if (strcmp(name, "--neighbours") == 0)
+            opt.neighbours = (unsigned)value;
+        else if (strcmp(name, "--loss") == 0)
+            opt.loss = value;
+        else if (strcmp(name, "--mobile") == 0)
+            opt.mobile = value;
+        else if (strcmp(name, "--speed") == 0)
+            opt.speed = value;
+        else if (strcmp(name, "--pause") == 0)
+            opt.pause = (clock_time_t)(value * CLOCK_SECOND);
+        else if (strcmp(name, "--duration") == 0)
+            opt.duration = (clock_time_t)(value * CLOCK_SECOND);
+        else if (strcmp(name, "--seed") == 0)
+            opt.seed = (unsigned long)value;
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    // The round delay jitters by +-5 s and the neighbour table entry is a uint8_t
+    if (opt.nodes < 2 || opt.density <= 0 || opt.range <= 0 || opt.send_interval < 5 * CLOCK_SECOND ||
+        opt.neighbours < 1 || opt.neighbours > 255)
+    {
+        fprintf(stderr, "Invalid options\n");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct timespec start, end;
+    uint32_t i;
+    unsigned long proximity_samples = 0, proximity_sum = 0;
+
+    parse_options(argc, argv);
+    rng_state = opt.seed * 0x9E3779B97F4A7C15ULL + 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    side = sqrt(opt.nodes * 10000.0 / opt.density);
+    nodes = calloc(opt.nodes, sizeof(*nodes));
+    if (nodes == NULL || !neighbour_grid_init(&grid, opt.nodes, side, opt.range))
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    for (i = 0; i < opt.nodes; i++)
+    {
+        node_t *node = &nodes[i];
+        contact_engine_init(&node->engine, report_departure);
+        node->engine.contact_timeout = opt.contact_timeout;
+        node->engine.inactivity_threshold = opt.inactivity;
+        grid.x[i] = rng_uniform() * side;
+        grid.y[i] = rng_uniform() * side;
+        node->rng = rng_next() | ((uint64_t)rng_next() << 32) | 1;
+        node->tx = rng_uniform() * side;
+        node->ty = rng_uniform() * side;
+        node->mobile = rng_uniform() < opt.mobile;
+        node->nbrs = malloc(sizeof(*node->nbrs) * opt.neighbours);
+        if (node->nbrs == NULL)
+        {
+            perror("malloc");
+            return 1;
+        }
+        // The motes boot together, as in Cooja, and start beaconing within a period
+        schedule(rng_next() % opt.send_interval, i, EV_ROUND, 0);
+        schedule(ACTIVITY_CHECK, i, EV_EXPIRE, 0);
+    }
+    neighbour_grid_update(&grid);
+    if (opt.mobile > 0)
+    {
+        schedule(CLOCK_SECOND, 0, EV_MOVE, 0);
+    }
+
+    while (heap_len > 0 && heap[0].time <= opt.duration)
+    {
+        event_t ev = pop_event();
+        stats.events++;
+
+        switch (ev.type)
+        {
+        case EV_ROUND:
+            start_round(ev.node, ev.time);
+            break;
+        case EV_BEACON:
+            send_beacon(ev.node, ev.arg, ev.time);
+            break;
+        case EV_EXPIRE:
+            contact_engine_expire(&nodes[ev.node].engine, ev.time);
+            proximity_sum += contact_engine_in_proximity(&nodes[ev.node].engine);
+            proximity_samples++;
+            schedule(ev.time + ACTIVITY_CHECK, ev.node, EV_EXPIRE, 0);
+            break;
+        case EV_MOVE:
+            move_nodes(ev.time);
+            schedule(ev.time + CLOCK_SECOND, 0, EV_MOVE, 0);
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("Motes: %u on %.0f x %.0f m (%.1f/ha), range %.0f m, %u%% mobile\n", opt.nodes, side, side,
+           opt.density, opt.range, (unsigned)(opt.mobile * 100));
+    printf("Engine: MAX_CONTACTS %d, send interval %lu s, contact timeout %lu s, inactivity %lu s\n",
+           MAX_CONTACTS, (unsigned long)(opt.send_interval / CLOCK_SECOND),
+           (unsigned long)(opt.contact_timeout / CLOCK_SECOND), (unsigned long)(opt.inactivity / CLOCK_SECOND));
+    printf("Beacons: %lu sent, %lu delivered\n", stats.beacons, stats.delivered);
+    printf("Reports: %lu group reports, %.2f members on average, %lu departures\n", stats.reports,
+           stats.reports ? (double)stats.report_members / stats.reports : 0.0, stats.departures);
+    printf("In proximity: %.2f contacts per mote on average\n",
+           proximity_samples ? (double)proximity_sum / proximity_samples : 0.0);
+    print_accuracy();
+    printf("Run: %lu s simulated, %lu events in %.2f s\n", (unsigned long)(opt.duration / CLOCK_SECOND),
+           stats.events, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    return 0;
+}
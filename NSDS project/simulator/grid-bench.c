@@ -0,0 +1,120 @@
+// Timing of the neighbour grid on a large crowd where every mote moves each
+// tick, the worst case of the simulator mobility step:
+//
+//   ./grid-bench [motes] [ticks] [density per ha] [range m]
+//
+// Defaults: 100000 motes, 100 ticks of one second at 1.4 m/s, 10/ha, 60 m
+// (the transmitting_range of GroupMonitoringProject.csc). The neighbour counts
+// of a sample of motes are checked against a brute-force scan.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "neighbour-grid.h"
+
+#define SAMPLE 200
+
+static double elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t motes = argc > 1 ? (uint32_t)atol(argv[1]) : 100000;
+    int ticks = argc > 2 ? atoi(argv[2]) : 100;
+    double density = argc > 3 ? atof(argv[3]) : 10;
+    double range = argc > 4 ? atof(argv[4]) : 60;
+    double side = sqrt(motes * 10000.0 / density);
+    double *heading;
+    uint32_t *degrees;
+    neighbour_grid_t grid;
+    struct timespec start;
+    double update_ms = 0, query_ms = 0;
+    unsigned long relinked = 0, pairs = 0;
+    int32_t i;
+    int tick;
+
+    if (motes < 2 || ticks < 1 || !neighbour_grid_init(&grid, motes, side, range))
+    {
+        fprintf(stderr, "Usage: %s [motes] [ticks] [density per ha] [range m]\n", argv[0]);
+        return 1;
+    }
+    heading = malloc(motes * sizeof(*heading));
+    degrees = malloc(motes * sizeof(*degrees));
+    if (heading == NULL || degrees == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    srand(1);
+    for (i = 0; i < (int32_t)motes; i++)
+    {
+        grid.x[i] = (double)rand() / RAND_MAX * side;
+        grid.y[i] = (double)rand() / RAND_MAX * side;
+        heading[i] = (double)rand() / RAND_MAX * 2 * M_PI;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    neighbour_grid_update(&grid);
+    printf("Grid: %u motes on %.0f x %.0f m, %d x %d cells, built in %.1f ms\n", motes, side, side, grid.dim,
+           grid.dim, elapsed_ms(&start));
+
+    for (tick = 0; tick < ticks; tick++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+#pragma omp parallel for schedule(static)
+        for (i = 0; i < (int32_t)motes; i++)
+        {
+            // Walk straight at 1.4 m/s, turning back at the border
+            grid.x[i] += 1.4 * cos(heading[i]);
+            grid.y[i] += 1.4 * sin(heading[i]);
+            if (grid.x[i] < 0 || grid.x[i] > side || grid.y[i] < 0 || grid.y[i] > side)
+            {
+                heading[i] += M_PI;
+            }
+        }
+        neighbour_grid_update(&grid);
+        update_ms += elapsed_ms(&start);
+        relinked += grid.relinked;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        neighbour_grid_degrees(&grid, range, degrees);
+        query_ms += elapsed_ms(&start);
+    }
+
+    for (i = 0; i < (int32_t)motes; i++)
+    {
+        pairs += degrees[i];
+    }
+    // Brute-force check of a sample of the last tick
+    for (i = 0; i < SAMPLE && i < (int32_t)motes; i++)
+    {
+        uint32_t id = (uint32_t)(((uint64_t)i * motes) / SAMPLE);
+        uint32_t expected = 0, other;
+        for (other = 0; other < motes; other++)
+        {
+            expected += other != id && neighbour_grid_distance(&grid, id, other) <= range;
+        }
+        if (expected != degrees[id])
+        {
+            fprintf(stderr, "Mote %u: %u neighbours in the grid, %u by brute force\n", id, degrees[id], expected);
+            return 1;
+        }
+    }
+
+    printf("Update: %.2f ms per tick, %.0f motes changed cell per tick\n", update_ms / ticks,
+           (double)relinked / ticks);
+    printf("Neighbours: %.2f ms per tick for every mote, %.1f in range on average\n", query_ms / ticks,
+           (double)pairs / motes);
+    printf("Checked %d motes against a brute-force scan\n", SAMPLE < motes ? SAMPLE : (int)motes);
+
+    free(heading);
+    free(degrees);
+    neighbour_grid_free(&grid);
+    return 0;
+}
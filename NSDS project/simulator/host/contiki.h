@@ -0,0 +1,16 @@
+#ifndef CONTIKI_H_
+#define CONTIKI_H_
+
+// Host build of the contact engine: the few Contiki definitions it relies on.
+// Time is kept in milliseconds.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint32_t clock_time_t;
+#define CLOCK_SECOND 1000
+
+#include "project-conf.h"
+
+#endif /* CONTIKI_H_ */
@@ -0,0 +1,17 @@
+#ifndef UIP_H_
+#define UIP_H_
+
+#include "contiki.h"
+
+typedef union uip_ip6addr_t
+{
+    uint8_t u8[16];
+    uint16_t u16[8];
+} uip_ip6addr_t;
+
+typedef uip_ip6addr_t uip_ipaddr_t;
+
+#define uip_ipaddr_cmp(addr1, addr2) (memcmp(addr1, addr2, sizeof(uip_ipaddr_t)) == 0)
+#define uip_ipaddr_copy(dest, src) (*((uip_ipaddr_t *)(dest)) = *((const uip_ipaddr_t *)(src)))
+
+#endif /* UIP_H_ */
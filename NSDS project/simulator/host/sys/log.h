@@ -0,0 +1,19 @@
+#ifndef LOG_H_
+#define LOG_H_
+
+// The simulator reports aggregates, the per-mote logs are compiled out
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DBG 4
+
+#define LOG_ERR(...) do {} while (0)
+#define LOG_WARN(...) do {} while (0)
+#define LOG_INFO(...) do {} while (0)
+#define LOG_DBG(...) do {} while (0)
+#define LOG_INFO_(...) do {} while (0)
+#define LOG_INFO_6ADDR(addr) do { (void)(addr); } while (0)
+
+#endif /* LOG_H_ */
@@ -0,0 +1,179 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "neighbour-grid.h"
+
+static int32_t cell_index(const neighbour_grid_t *grid, double x, double y)
+{
+    int cx = (int)(x / grid->cell_size);
+    int cy = (int)(y / grid->cell_size);
+
+    // Motes on or past the border share the outer cells
+    cx = cx < 0 ? 0 : (cx >= grid->dim ? grid->dim - 1 : cx);
+    cy = cy < 0 ? 0 : (cy >= grid->dim ? grid->dim - 1 : cy);
+    return cy * grid->dim + cx;
+}
+
+static void unlink_mote(neighbour_grid_t *grid, uint32_t id)
+{
+    int32_t cell = grid->cell[id];
+
+    if (grid->prev[id] >= 0)
+    {
+        grid->next[grid->prev[id]] = grid->next[id];
+    }
+    else
+    {
+        grid->head[cell] = grid->next[id];
+    }
+    if (grid->next[id] >= 0)
+    {
+        grid->prev[grid->next[id]] = grid->prev[id];
+    }
+}
+
+static void link_mote(neighbour_grid_t *grid, uint32_t id, int32_t cell)
+{
+    grid->cell[id] = cell;
+    grid->prev[id] = -1;
+    grid->next[id] = grid->head[cell];
+    if (grid->head[cell] >= 0)
+    {
+        grid->prev[grid->head[cell]] = id;
+    }
+    grid->head[cell] = id;
+}
+
+int neighbour_grid_init(neighbour_grid_t *grid, uint32_t count, double side, double cell_size)
+{
+    int32_t i;
+
+    grid->count = count;
+    grid->cell_size = cell_size;
+    grid->dim = (int)ceil(side / cell_size);
+    if (grid->dim < 1)
+    {
+        grid->dim = 1;
+    }
+    grid->x = calloc(count, sizeof(*grid->x));
+    grid->y = calloc(count, sizeof(*grid->y));
+    grid->next = malloc(count * sizeof(*grid->next));
+    grid->prev = malloc(count * sizeof(*grid->prev));
+    grid->cell = malloc(count * sizeof(*grid->cell));
+    grid->target = malloc(count * sizeof(*grid->target));
+    grid->head = malloc((size_t)grid->dim * grid->dim * sizeof(*grid->head));
+    grid->relinked = 0;
+    if (!grid->x || !grid->y || !grid->next || !grid->prev || !grid->cell || !grid->target || !grid->head)
+    {
+        neighbour_grid_free(grid);
+        return 0;
+    }
+
+    for (i = 0; i < grid->dim * grid->dim; i++)
+    {
+        grid->head[i] = -1;
+    }
+    // Not linked yet: the first update links every mote
+    for (i = 0; i < (int32_t)count; i++)
+    {
+        grid->cell[i] = -1;
+    }
+    return 1;
+}
+
+void neighbour_grid_free(neighbour_grid_t *grid)
+{
+    free(grid->x);
+    free(grid->y);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cell);
+    free(grid->target);
+    free(grid->head);
+    grid->x = grid->y = NULL;
+    grid->next = grid->prev = grid->cell = grid->target = grid->head = NULL;
+}
+
+void neighbour_grid_update(neighbour_grid_t *grid)
+{
+    int32_t count = (int32_t)grid->count;
+    int32_t i;
+    uint32_t relinked = 0;
+
+    // Finding the new cells is the bulk of the work and runs in parallel, the
+    // few motes that crossed a cell border are relinked afterwards
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < count; i++)
+    {
+        grid->target[i] = cell_index(grid, grid->x[i], grid->y[i]);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (grid->target[i] != grid->cell[i])
+        {
+            if (grid->cell[i] >= 0)
+            {
+                unlink_mote(grid, i);
+            }
+            link_mote(grid, i, grid->target[i]);
+            relinked++;
+        }
+    }
+    grid->relinked = relinked;
+}
+
+double neighbour_grid_distance(const neighbour_grid_t *grid, uint32_t a, uint32_t b)
+{
+    return hypot(grid->x[a] - grid->x[b], grid->y[a] - grid->y[b]);
+}
+
+void neighbour_grid_for_each(const neighbour_grid_t *grid, uint32_t id, double max_dist,
+                             neighbour_grid_visit_t visit, void *ctx)
+{
+    int cx = grid->cell[id] % grid->dim;
+    int cy = grid->cell[id] / grid->dim;
+    double max_sq = max_dist * max_dist;
+    int x, y;
+
+    for (y = cy - 1; y <= cy + 1; y++)
+    {
+        for (x = cx - 1; x <= cx + 1; x++)
+        {
+            int32_t other;
+            if (x < 0 || y < 0 || x >= grid->dim || y >= grid->dim)
+            {
+                continue;
+            }
+            for (other = grid->head[y * grid->dim + x]; other >= 0; other = grid->next[other])
+            {
+                double dx = grid->x[id] - grid->x[other];
+                double dy = grid->y[id] - grid->y[other];
+                if ((uint32_t)other != id && dx * dx + dy * dy <= max_sq && !visit(id, other, ctx))
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static int count_neighbour(uint32_t id, uint32_t other, void *ctx)
+{
+    (void)id;
+    (void)other;
+    (*(uint32_t *)ctx)++;
+    return 1;
+}
+
+void neighbour_grid_degrees(const neighbour_grid_t *grid, double max_dist, uint32_t *degrees)
+{
+    int32_t i;
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (i = 0; i < (int32_t)grid->count; i++)
+    {
+        degrees[i] = 0;
+        neighbour_grid_for_each(grid, i, max_dist, count_neighbour, &degrees[i]);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef NEIGHBOUR_GRID_H_
+#define NEIGHBOUR_GRID_H_
+
+#include <stdint.h>
+
+// Uniform grid over the simulated area with cells of the radio range, so the
+// motes in range of one are in the 3x3 cells around its own. The same scheme
+// is used by benchmarks/neighbour-grid.js for the scenario generator.
+//
+// The grid owns the positions. Moving motes write x[] and y[] (from several
+// threads if they like) and call neighbour_grid_update(), which relinks only
+// the motes that changed cell. Lookups are read-only and can run in parallel.
+
+typedef struct neighbour_grid
+{
+    uint32_t count;
+    double cell_size;
+    int dim;         // Cells per side, the area is dim * cell_size square from the origin
+    double *x, *y;
+    int32_t *head;   // First mote of each cell, -1 when empty
+    int32_t *next;   // Doubly linked list of the motes of a cell
+    int32_t *prev;
+    int32_t *cell;   // Cell each mote is linked in
+    int32_t *target; // Cell each mote belongs in, scratch of the update
+    uint32_t relinked; // Motes that changed cell in the last update
+} neighbour_grid_t;
+
+// Allocates a grid for count motes over a side x side area. Returns 0 on failure.
+int neighbour_grid_init(neighbour_grid_t *grid, uint32_t count, double side, double cell_size);
+void neighbour_grid_free(neighbour_grid_t *grid);
+
+// Links the motes whose cell changed since the last update (all of them the first time)
+void neighbour_grid_update(neighbour_grid_t *grid);
+
+double neighbour_grid_distance(const neighbour_grid_t *grid, uint32_t a, uint32_t b);
+
+// Calls visit for every other mote within max_dist (at most the cell size) of
+// the mote, stopping early when it returns 0
+typedef int (*neighbour_grid_visit_t)(uint32_t id, uint32_t other, void *ctx);
+void neighbour_grid_for_each(const neighbour_grid_t *grid, uint32_t id, double max_dist,
+                             neighbour_grid_visit_t visit, void *ctx);
+
+// Number of motes within max_dist of every mote, computed in parallel
+void neighbour_grid_degrees(const neighbour_grid_t *grid, double max_dist, uint32_t *degrees);
+
+#endif /* NEIGHBOUR_GRID_H_ */
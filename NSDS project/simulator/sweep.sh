@@ -0,0 +1,32 @@
+#!/bin/sh
+# Parameter sweep of the contact engine on the host simulator. MAX_CONTACTS is
+# a build option, so every pool size gets its own binary; the timings are
+# runtime options. Extra simulator options go in SIM_OPTS, e.g.
+#   SIM_OPTS="--nodes 20000 --mobile 0.2" ./sweep.sh
+# Pool sizes, send intervals and contact timeouts can be overridden with
+# POOLS, INTERVALS and TIMEOUTS.
+
+set -e
+
+SIMULATOR=$(cd "$(dirname "$0")" && pwd)
+POOLS=${POOLS:-"16 32 64 128"}
+INTERVALS=${INTERVALS:-"10 20 30"}
+TIMEOUTS=${TIMEOUTS:-"20 30 60"}
+
+cd "$SIMULATOR"
+for pool in $POOLS; do
+    make -s MAX_CONTACTS="$pool" contact-sim
+    mv contact-sim "contact-sim-$pool"
+done
+
+for pool in $POOLS; do
+    for interval in $INTERVALS; do
+        for timeout in $TIMEOUTS; do
+            # A silent neighbour must survive a few beacon periods
+            inactivity=$((interval * 3))
+            echo "== MAX_CONTACTS $pool, send interval $interval s, contact timeout $timeout s"
+            "./contact-sim-$pool" --send-interval "$interval" --contact-timeout "$timeout" \
+                --inactivity "$inactivity" $SIM_OPTS | grep -E "Reports|In proximity|Contacts|Pool|Run"
+        done
+    done
+done
@@ -6,6 +6,9 @@
 #include "net/routing/routing.h"
 #include "net/netstack.h"
 #include "net/ipv6/simple-udp.h"
+#include "net/ipv6/uipbuf.h"
+
+#include "wake-window.h"
 
 // Log configuration
 #include "sys/log.h"
@@ -33,7 +36,8 @@ PROCESS_THREAD(udp_signaler_process, ev, data){
     simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, NULL);
 
     // Starting udp communication periodic timer
-    etimer_set(&udp_find_timer, random_rand() % SEND_INTERVAL);
+    wake_window_init();
+    etimer_set(&udp_find_timer, wake_window_delay(random_rand() % SEND_INTERVAL));
     while(1) {
         PROCESS_WAIT_EVENT();
         if (ev == PROCESS_EVENT_TIMER       &&  data == &udp_find_timer){
@@ -46,6 +50,8 @@ PROCESS_THREAD(udp_signaler_process, ev, data){
             if (nbr != NULL){
             send_to_ipaddr = &(nbr->ipaddr);
             uint8_t isSignal = 1;
+            // A lost beacon is replaced by the next one, retrying only adds contention
+            uipbuf_set_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS, CONTACT_BEACON_MAX_TX);
             simple_udp_sendto(&udp_conn, &isSignal, sizeof(isSignal), send_to_ipaddr);
 
             // Move pointer down the table stack
@@ -54,7 +60,7 @@ PROCESS_THREAD(udp_signaler_process, ev, data){
             }
             else {
                 // Set a periodic timer for the frequency of communication (jitter of +- 5 seconds on SEND INTERVAL)
-                etimer_set(&udp_find_timer, SEND_INTERVAL - (5 * CLOCK_SECOND) + (random_rand() % (10 * CLOCK_SECOND)));
+                etimer_set(&udp_find_timer, wake_window_delay(SEND_INTERVAL - (5 * CLOCK_SECOND) + (random_rand() % (10 * CLOCK_SECOND))));
             }
         }
     }